@@ -0,0 +1,98 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Accelerometer Calibration
+ * hid-wiimote reports the raw 10-bit readings minus 0x200 and does not apply
+ * the calibration stored on the device. Each axis is mapped linearly so the
+ * zero reading becomes 0g and the 1g reading becomes 1g. The scale factors
+ * are computed once when the calibration is set, so converting a sample is
+ * three subtractions and three multiplications.
+ *
+ * Pitch and roll are only meaningful while the device is not accelerated.
+ * Roll is the rotation around the long (y) axis, pitch is the angle of the
+ * long axis against the horizon.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "accel.h"
+#include "xwiimote.h"
+
+/*
+ * Minimax polynomial for atan() on [0, 1]. The argument is reduced to that
+ * range by swapping and mirroring, which costs a single division.
+ */
+float xwii__atan2(float y, float x)
+{
+	float ax = fabsf(x), ay = fabsf(y), a, s, r;
+
+	if (ax == 0.0f && ay == 0.0f)
+		return 0.0f;
+
+	a = (ax < ay) ? ax / ay : ay / ax;
+	s = a * a;
+	r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+
+	if (ay > ax)
+		r = (float)M_PI_2 - r;
+	if (x < 0.0f)
+		r = (float)M_PI - r;
+	if (y < 0.0f)
+		r = -r;
+
+	return r;
+}
+
+void xwii__accel_init(struct xwii__accel *a)
+{
+	struct xwii_event_abs zero = { 0, 0, 0 };
+	struct xwii_event_abs one = {
+		XWII__ACCEL_1G, XWII__ACCEL_1G, XWII__ACCEL_1G
+	};
+
+	a->flags = 0;
+	xwii__accel_calibrate(a, &zero, &one);
+}
+
+bool xwii__accel_calibrate(struct xwii__accel *a,
+			   const struct xwii_event_abs *zero,
+			   const struct xwii_event_abs *one)
+{
+	if (one->x == zero->x || one->y == zero->y || one->z == zero->z)
+		return false;
+
+	a->zero = *zero;
+	a->one = *one;
+	a->scale[0] = 1.0f / (one->x - zero->x);
+	a->scale[1] = 1.0f / (one->y - zero->y);
+	a->scale[2] = 1.0f / (one->z - zero->z);
+	return true;
+}
+
+void xwii__accel_update(const struct xwii__accel *a,
+			const struct xwii_event *ev, struct xwii_event *out)
+{
+	struct xwii_event_accel *o = &out->v.accel;
+	const struct xwii_event_abs *raw = &ev->v.abs[0];
+
+	memset(out, 0, sizeof(*out));
+	out->time = ev->time;
+	out->type = XWII_EVENT_ACCEL_CALIBRATED;
+
+	o->x = (raw->x - a->zero.x) * a->scale[0];
+	o->y = (raw->y - a->zero.y) * a->scale[1];
+	o->z = (raw->z - a->zero.z) * a->scale[2];
+
+	if (a->flags & XWII_ACCEL_TILT) {
+		o->roll = xwii__atan2(o->x, o->z);
+		o->pitch = xwii__atan2(o->y, sqrtf(o->x * o->x +
+						   o->z * o->z));
+	}
+}
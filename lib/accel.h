@@ -0,0 +1,49 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Accelerometer Calibration
+ * Converts raw accelerometer data into g and derives pitch and roll from the
+ * gravity vector. Nothing in here allocates memory and nothing in here is
+ * part of the public API.
+ */
+
+#ifndef XWII_ACCEL_H
+#define XWII_ACCEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* default raw reading at 1g relative to zero */
+#define XWII__ACCEL_1G 100
+
+/* accelerometer state; plain data so it can be embedded into xwii_iface */
+struct xwii__accel {
+	/* enum xwii_accel_flags */
+	unsigned int flags;
+	/* raw reading at 0g and 1g per axis */
+	struct xwii_event_abs zero;
+	struct xwii_event_abs one;
+	/* precomputed 1 / (one - zero) per axis */
+	float scale[3];
+};
+
+/* atan2() approximation, max error about 2e-4 rad */
+float xwii__atan2(float y, float x);
+
+/* reset \a to default calibration */
+void xwii__accel_init(struct xwii__accel *a);
+/* set calibration; returns false if any axis of \zero and \one are equal */
+bool xwii__accel_calibrate(struct xwii__accel *a,
+			   const struct xwii_event_abs *zero,
+			   const struct xwii_event_abs *one);
+/* convert raw accelerometer event \ev into \out */
+void xwii__accel_update(const struct xwii__accel *a,
+			const struct xwii_event *ev, struct xwii_event *out);
+
+#endif /* XWII_ACCEL_H */
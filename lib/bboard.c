@@ -0,0 +1,97 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Balance Board Weight
+ * hid-wiimote reads the factory calibration (sensor readings at 0, 17 and
+ * 34 kg) from the board's EEPROM and reports interpolated values in units of
+ * 10g. We only convert units, low-pass filter each sensor and subtract the
+ * tare offset.
+ *
+ * Sensors are ordered top-right, bottom-right, top-left, bottom-left. The
+ * center of pressure is the weighted average of the sensor positions. Step
+ * detection uses the filtered total weight with hysteresis; the weight is
+ * considered stable while its moving standard deviation is small.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bboard.h"
+#include "xwiimote.h"
+
+/* smoothing factor of the moving mean and variance of the total weight */
+#define BBOARD_VAR_FACTOR 0.125f
+
+void xwii__bboard_reset(struct xwii__bboard *b)
+{
+	float t[4];
+
+	memcpy(t, b->tare, sizeof(t));
+	memset(b, 0, sizeof(*b));
+	memcpy(b->tare, t, sizeof(t));
+}
+
+void xwii__bboard_tare(struct xwii__bboard *b)
+{
+	memcpy(b->tare, b->kg, sizeof(b->tare));
+	b->mean = 0.0f;
+	b->var = 0.0f;
+	b->on = false;
+}
+
+void xwii__bboard_update(struct xwii__bboard *b, const struct xwii_event *ev,
+			 struct xwii_event *out)
+{
+	struct xwii_event_weight *w = &out->v.weight;
+	float alpha, kg, total = 0.0f, d;
+	int64_t time, dt;
+	unsigned int i;
+
+	time = ev->time.tv_sec * 1000000LL + ev->time.tv_usec;
+	dt = time - b->time;
+	if (!b->time || dt <= 0 || dt > 1000000)
+		alpha = 1.0f;
+	else
+		alpha = 1.0f / (1.0f + 1.0f /
+				(2.0f * (float)M_PI * XWII__BBOARD_CUTOFF *
+				 dt * 1e-6f));
+	b->time = time;
+
+	memset(out, 0, sizeof(*out));
+	out->time = ev->time;
+	out->type = XWII_EVENT_BALANCE_BOARD_WEIGHT;
+
+	for (i = 0; i < 4; ++i) {
+		kg = ev->v.abs[i].x / XWII__BBOARD_UNITS_KG;
+		b->kg[i] += alpha * (kg - b->kg[i]);
+		w->kg[i] = b->kg[i] - b->tare[i];
+		total += w->kg[i];
+	}
+	w->total = total;
+
+	if (total > 1.0f) {
+		w->cop_x = (w->kg[0] + w->kg[1] - w->kg[2] - w->kg[3]) /
+			   total * XWII__BBOARD_HALF_WIDTH;
+		w->cop_y = (w->kg[0] + w->kg[2] - w->kg[1] - w->kg[3]) /
+			   total * XWII__BBOARD_HALF_HEIGHT;
+	}
+
+	d = total - b->mean;
+	b->mean += BBOARD_VAR_FACTOR * d;
+	b->var += BBOARD_VAR_FACTOR * (d * d - b->var);
+	w->stable = b->var < XWII__BBOARD_STABLE * XWII__BBOARD_STABLE;
+
+	if (!b->on && total > XWII__BBOARD_STEP_ON) {
+		b->on = true;
+		w->step = XWII_BBOARD_STEP_ON;
+	} else if (b->on && total < XWII__BBOARD_STEP_OFF) {
+		b->on = false;
+		w->step = XWII_BBOARD_STEP_OFF;
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Balance Board Weight
+ * Streaming weight, center of pressure and step detection on top of the
+ * balance board sensor data. Nothing in here allocates memory and nothing in
+ * here is part of the public API.
+ */
+
+#ifndef XWII_BBOARD_H
+#define XWII_BBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* kernel units per kg; hid-wiimote reports calibrated values in 10g */
+#define XWII__BBOARD_UNITS_KG 100.0f
+/* half distance between the left and right / top and bottom sensors in cm */
+#define XWII__BBOARD_HALF_WIDTH 21.65f
+#define XWII__BBOARD_HALF_HEIGHT 11.9f
+/* low-pass cutoff in Hz */
+#define XWII__BBOARD_CUTOFF 4.0f
+/* step detection thresholds in kg, with hysteresis */
+#define XWII__BBOARD_STEP_ON 5.0f
+#define XWII__BBOARD_STEP_OFF 2.0f
+/* max standard deviation in kg of the total weight while stable */
+#define XWII__BBOARD_STABLE 0.1f
+
+/* balance board state; plain data so it can be embedded into xwii_iface */
+struct xwii__bboard {
+	/* timestamp of the last sample in us or 0 */
+	int64_t time;
+	/* low-pass filtered weight per sensor in kg, before tare */
+	float kg[4];
+	/* tare offset per sensor in kg */
+	float tare[4];
+	/* moving mean and variance of the total weight */
+	float mean;
+	float var;
+	/* set while someone is on the board */
+	bool on;
+};
+
+/* reset \b but keep the tare offset */
+void xwii__bboard_reset(struct xwii__bboard *b);
+/* use current weight as zero */
+void xwii__bboard_tare(struct xwii__bboard *b);
+/* process balance board event \ev and fill \out */
+void xwii__bboard_update(struct xwii__bboard *b, const struct xwii_event *ev,
+			 struct xwii_event *out);
+
+#endif /* XWII_BBOARD_H */
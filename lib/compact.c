@@ -0,0 +1,122 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Compact Events
+ * A compact event is a 12 byte header followed by the payload values of the
+ * event type, rounded up to a multiple of 8 bytes. Values known to fit into
+ * 16 bits are stored as such, everything else as 32 bit values. Only the
+ * fields every read path sets are read from \ev, so its remaining payload does
+ * not have to be cleared. Padding within a record is always zeroed, so equal
+ * events encode to equal bytes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compact.h"
+#include "xwiimote.h"
+
+#define COMPACT_HEADER 12
+
+static size_t compact_size(struct xwii_compact_event *out, unsigned int num,
+			   size_t width)
+{
+	size_t size;
+
+	size = (COMPACT_HEADER + num * width + 7) & ~(size_t)7;
+	if (size < 16)
+		size = 16;
+
+	out->size = size;
+	out->num = num;
+	memset(&out->v, 0, size - COMPACT_HEADER);
+	return size;
+}
+
+size_t xwii__compact_encode(const struct xwii_event *ev,
+			    struct xwii_compact_event *out)
+{
+	const struct xwii_event_abs *abs = ev->v.abs;
+	size_t size;
+	unsigned int i;
+
+	switch (ev->type) {
+	case XWII_EVENT_KEY:
+	case XWII_EVENT_NUNCHUK_KEY:
+	case XWII_EVENT_CLASSIC_CONTROLLER_KEY:
+	case XWII_EVENT_PRO_CONTROLLER_KEY:
+	case XWII_EVENT_DRUMS_KEY:
+	case XWII_EVENT_GUITAR_KEY:
+		size = compact_size(out, 2, sizeof(int16_t));
+		out->v.s[0] = ev->v.key.code;
+		out->v.s[1] = ev->v.key.state;
+		break;
+	case XWII_EVENT_ACCEL:
+	case XWII_EVENT_MOTION_PLUS:
+		size = compact_size(out, 3, sizeof(int32_t));
+		out->v.l[0] = abs[0].x;
+		out->v.l[1] = abs[0].y;
+		out->v.l[2] = abs[0].z;
+		break;
+	case XWII_EVENT_IR:
+		size = compact_size(out, 8, sizeof(int16_t));
+		for (i = 0; i < 4; ++i) {
+			out->v.s[i * 2] = abs[i].x;
+			out->v.s[i * 2 + 1] = abs[i].y;
+		}
+		break;
+	case XWII_EVENT_BALANCE_BOARD:
+		size = compact_size(out, 4, sizeof(int32_t));
+		for (i = 0; i < 4; ++i)
+			out->v.l[i] = abs[i].x;
+		break;
+	case XWII_EVENT_NUNCHUK_MOVE:
+		size = compact_size(out, 5, sizeof(int16_t));
+		out->v.s[0] = abs[0].x;
+		out->v.s[1] = abs[0].y;
+		out->v.s[2] = abs[1].x;
+		out->v.s[3] = abs[1].y;
+		out->v.s[4] = abs[1].z;
+		break;
+	case XWII_EVENT_CLASSIC_CONTROLLER_MOVE:
+	case XWII_EVENT_PRO_CONTROLLER_MOVE:
+		i = ev->type == XWII_EVENT_PRO_CONTROLLER_MOVE ? 2 : 3;
+		size = compact_size(out, i * 2, sizeof(int16_t));
+		while (i--) {
+			out->v.s[i * 2] = abs[i].x;
+			out->v.s[i * 2 + 1] = abs[i].y;
+		}
+		break;
+	case XWII_EVENT_GUITAR_MOVE:
+		size = compact_size(out, 4, sizeof(int16_t));
+		out->v.s[0] = abs[0].x;
+		out->v.s[1] = abs[0].y;
+		out->v.s[2] = abs[1].x;
+		out->v.s[3] = abs[2].x;
+		break;
+	case XWII_EVENT_DRUMS_MOVE:
+		size = compact_size(out, XWII_DRUMS_ABS_NUM + 1,
+				    sizeof(int16_t));
+		out->v.s[0] = abs[XWII_DRUMS_ABS_PAD].x;
+		out->v.s[1] = abs[XWII_DRUMS_ABS_PAD].y;
+		for (i = 1; i < XWII_DRUMS_ABS_NUM; ++i)
+			out->v.s[i + 1] = abs[i].x;
+		break;
+	case XWII_EVENT_WATCH:
+	case XWII_EVENT_GONE:
+		size = compact_size(out, 0, 0);
+		break;
+	default:
+		return 0;
+	}
+
+	out->time = ev->time.tv_sec * 1000000000ULL +
+		    ev->time.tv_usec * 1000ULL;
+	out->type = ev->type;
+	return size;
+}
@@ -0,0 +1,28 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Compact Events
+ * Encodes events into struct xwii_compact_event. Nothing in here allocates
+ * memory and nothing in here is part of the public API.
+ */
+
+#ifndef XWII_COMPACT_H
+#define XWII_COMPACT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/*
+ * encode \ev into \out; returns the record size in bytes or 0 if the event
+ * type has no compact encoding
+ */
+size_t xwii__compact_encode(const struct xwii_event *ev,
+			    struct xwii_compact_event *out);
+
+#endif /* XWII_COMPACT_H */
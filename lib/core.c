@@ -4,18 +4,42 @@
  * Dedicated to the Public Domain
  */
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#ifdef HAVE_UDEV
 #include <libudev.h>
+#endif
+#include <limits.h>
 #include <linux/input.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
+#include "accel.h"
+#include "bboard.h"
+#include "compact.h"
+#include "drums.h"
+#include "filter.h"
+#include "frame.h"
+#include "fusion.h"
+#include "gesture.h"
+#include "history.h"
+#include "hub.h"
+#include "pointer.h"
+#include "recorder.h"
+#include "stick.h"
+#include "swing.h"
+#include "sysfs.h"
 #include "xwiimote.h"
 
 /* interfaces */
@@ -37,6 +61,72 @@ enum xwii_if_base_idx {
 	XWII_IF_NUM,
 };
 
+/*
+ * Rest detector
+ * Tracks an exponential moving mean and variance of a 3-axis sensor. Means
+ * are stored as Q8 fixed-point, variances in squared raw units. A sensor is
+ * considered at rest while the variance of all axes is below a threshold.
+ */
+#define XWII__REST_SHIFT 3
+
+struct xwii_rest {
+	int64_t mean[3];
+	int64_t var[3];
+	unsigned int num;
+};
+
+/* default rest thresholds as standard deviation in raw units */
+#define XWII__MP_REST_GYRO 100
+#define XWII__MP_REST_ACCEL 3
+/* number of consecutive resting samples before the MP bias is updated */
+#define XWII__MP_REST_SAMPLES 32
+
+/* ready interfaces skipped this often are served first */
+#define XWII__SCHED_STARVE 4
+
+/*
+ * max number of queued derived events; a single drums report may queue a hit
+ * for every drum on top of the other derived events
+ */
+#define XWII__PENDING_NUM 16
+/* default orientation fusion gain */
+#define XWII__FUSION_GAIN 0.5f
+
+/*
+ * MOVE event deadband
+ * A MOVE event is only returned if an axis differs from the last returned
+ * event by more than its threshold. Thresholds are per abs value and axis,
+ * in raw units; a negative threshold ignores the axis.
+ */
+#define XWII__DEADBAND_NUM 4
+
+struct xwii_deadband {
+	unsigned int num;
+	bool valid;
+	struct xwii_event_abs thr[XWII__DEADBAND_NUM];
+	struct xwii_event_abs last[XWII__DEADBAND_NUM];
+};
+
+/*
+ * Rate limit
+ * Reports are returned at most once per period, based on kernel timestamps.
+ * Reports in between are either dropped (latest wins) or summed up and
+ * returned as average with the next returned report.
+ */
+#define XWII__RATE_NUM 4
+
+struct xwii_rate {
+	/* period in us or 0 if disabled */
+	int64_t period;
+	/* timestamp in us when the next report may be returned */
+	int64_t next;
+	/* enum xwii_rate_mode */
+	unsigned int mode;
+	/* summed up reports for XWII_RATE_AVERAGE */
+	unsigned int num;
+	int64_t sum[XWII__RATE_NUM][3];
+};
+
 /* event interface */
 struct xwii_if {
 	/* device node as /dev/input/eventX or NULL */
@@ -45,6 +135,15 @@ struct xwii_if {
 	int fd;
 	/* temporary state during device detection */
 	unsigned int available : 1;
+	/* CLOCK_MONOTONIC time in ns until which an on-demand iface is used */
+	uint64_t demand_until;
+	/* kernel timestamp of the last event or 0 */
+	struct timeval last;
+	/* set if automatically reopened and no event was read since */
+	unsigned int reopened : 1;
+	/* event read ahead by sched_peek(), returned by the next read */
+	unsigned int peeked : 1;
+	struct input_event peek;
 };
 
 /* main device interface */
@@ -53,50 +152,137 @@ struct xwii_iface {
 	size_t ref;
 	/* epoll file descriptor */
 	int efd;
+#ifdef HAVE_UDEV
 	/* udev context */
 	struct udev *udev;
 	/* main udev device */
 	struct udev_device *dev;
 	/* udev monitor */
 	struct udev_monitor *umon;
+#else
+	/* resolved sysfs path of the main device */
+	char *syspath;
+	/* kernel uevent monitor */
+	struct xwii__umon *umon;
+#endif
 
 	/* bitmask of open interfaces */
 	unsigned int ifaces;
 	/* interfaces */
 	struct xwii_if ifs[XWII_IF_NUM];
-	/* device type attribute */
-	char *devtype_attr;
-	/* extension attribute */
-	char *extension_attr;
+	/* set once the device was scanned for interfaces */
+	unsigned int scanned : 1;
 	/* battery capacity attribute */
 	char *battery_attr;
 	/* led brightness attributes */
 	char *led_attrs[4];
 
+	/* on-demand interfaces, see xwii_iface_set_demand_policy() */
+	unsigned int demand_ifaces;
+	unsigned int demand_subscribed;
+	uint64_t demand_idle;
+	/* timerfd to close idle on-demand interfaces or -1 */
+	int demand_fd;
+	/* interfaces to reopen on hotplug, see xwii_iface_set_auto_open() */
+	unsigned int auto_ifaces;
+	/* runtime statistics */
+	struct xwii_iface_stats stats;
+	/* dispatch rank per interface, see xwii_iface_set_priority() */
+	unsigned int sched_rank[XWII_IF_NUM];
+	/* dispatch calls a ready interface was skipped in a row */
+	unsigned int sched_skip[XWII_IF_NUM];
+	/* hub this device belongs to or NULL, see xwii_hub_add() */
+	struct xwii_hub *hub;
+	unsigned int hub_slot;
+	/* frame assembler, see xwii_iface_set_frames() */
+	unsigned int frame_enabled : 1;
+	struct xwii__frame frame;
+	/* set while xwii_iface_dispatch_compact() reads events */
+	unsigned int compact : 1;
+	/* sample history, see xwii_iface_set_history() */
+	struct xwii__history *history_accel;
+	struct xwii__history *history_ir;
+	struct xwii__history *history_mp;
+	/* flight recorder, see xwii_iface_set_recorder() */
+	struct xwii__recorder *recorder;
+	/* ring of derived events, returned before new kernel events */
+	struct xwii_event pending[XWII__PENDING_NUM];
+	unsigned int pending_first;
+	unsigned int pending_num;
+
 	/* rumble-id for base-core interface force-feedback or -1 */
 	int rumble_id;
 	int rumble_fd;
 	/* accelerometer data cache */
 	struct xwii_event_abs accel_cache;
+	/* accelerometer calibration, see xwii_iface_set_accel_calibrated() */
+	struct xwii__accel accel;
 	/* IR data cache */
 	struct xwii_event_abs ir_cache[4];
+	/* IR smoothing, see xwii_iface_set_ir_filter() */
+	struct xwii__filter_params ir_filter;
+	struct xwii__filter ir_filter_state[4][2];
+	/* IR pointer, see xwii_iface_set_pointer() */
+	unsigned int pointer_enabled : 1;
+	struct xwii__pointer pointer;
 	/* balance board weight cache */
 	struct xwii_event_abs bboard_cache[4];
+	/* balance board weight, see xwii_iface_set_bboard_weight() */
+	unsigned int bboard_enabled : 1;
+	struct xwii__bboard bboard;
 	/* motion plus cache */
 	struct xwii_event_abs mp_cache;
-	/* motion plus normalization */
+	/* motion plus normalization values (times 100) */
 	struct xwii_event_abs mp_normalizer;
 	int32_t mp_normalize_factor;
+	/* motion plus bias as Q8 fixed-point, see mp_estimate_bias() */
+	int64_t mp_bias[3];
+	int64_t mp_bias_rate;
+	/* motion plus rest detection */
+	struct xwii_rest mp_rest;
+	struct xwii_rest accel_rest;
+	int64_t mp_rest_gyro;
+	int64_t mp_rest_accel;
+	unsigned int mp_rest_count;
+	unsigned int accel_resting : 1;
+	/* orientation fusion of MP and accelerometer data */
+	struct xwii__fusion fusion;
+	/* gesture templates, allocated on first use */
+	struct xwii__gesture *gesture;
+	/* swing detection, see xwii_iface_set_swing() */
+	struct xwii__swing swing_accel;
+	struct xwii__swing swing_mp;
 	/* pro controller cache */
 	struct xwii_event_abs pro_cache[2];
 	/* classic controller cache */
 	struct xwii_event_abs classic_cache[3];
 	/* nunchuk cache */
 	struct xwii_event_abs nunchuk_cache[2];
+	/* MOVE deadbands, see xwii_iface_set_deadband() */
+	struct xwii_deadband pro_deadband;
+	struct xwii_deadband classic_deadband;
+	struct xwii_deadband nunchuk_deadband;
+	struct xwii_deadband bboard_deadband;
+	/* rate limits, see xwii_iface_set_rate() */
+	struct xwii_rate accel_rate;
+	struct xwii_rate bboard_rate;
+	/* analog stick processing, see xwii_iface_set_stick() */
+	struct xwii__stick pro_stick;
+	struct xwii__stick classic_stick;
+	struct xwii__stick nunchuk_stick;
 	/* drums cache */
 	struct xwii_event_abs drums_cache[XWII_DRUMS_ABS_NUM];
+	/* drum hit detection, see xwii_iface_set_drum_hits() */
+	unsigned int drums_hits : 1;
+	struct xwii__drums drums;
 	/* guitar cache */
 	struct xwii_event_abs guitar_cache[3];
+	/* pressed frets as enum xwii_guitar_frets */
+	unsigned int guitar_frets;
+	/* note events, see xwii_iface_set_guitar_notes() */
+	unsigned int guitar_notes : 1;
+	int32_t guitar_whammy;
+	int32_t guitar_slider;
 };
 
 /* table to convert interface to name */
@@ -156,12 +342,32 @@ static int iface_to_if_table[] = {
 	[XWII_IFACE_GUITAR] = XWII_IF_GUITAR,
 };
 
+/* default dispatch rank; keys first, then sticks, then motion sensors */
+static const unsigned int if_rank_table[] = {
+	[XWII_IF_CORE] = 0,
+	[XWII_IF_PRO_CONTROLLER] = 1,
+	[XWII_IF_CLASSIC_CONTROLLER] = 2,
+	[XWII_IF_GUITAR] = 3,
+	[XWII_IF_DRUMS] = 4,
+	[XWII_IF_NUNCHUK] = 5,
+	[XWII_IF_BALANCE_BOARD] = 6,
+	[XWII_IF_ACCEL] = 7,
+	[XWII_IF_MOTION_PLUS] = 8,
+	[XWII_IF_IR] = 9,
+};
+
 /* convert name to interface or -1 */
 static int if_to_iface(unsigned int ifs)
 {
 	return if_to_iface_table[ifs];
 }
 
+/* recorder slot of interface \tif; the bit number of its public interface */
+static unsigned int recorder_slot(unsigned int tif)
+{
+	return __builtin_ctz(if_to_iface_table[tif]);
+}
+
 XWII__EXPORT
 const char *xwii_get_iface_name(unsigned int iface)
 {
@@ -173,6 +379,90 @@ const char *xwii_get_iface_name(unsigned int iface)
 	return if_to_name_table[iface_to_if_table[iface]];
 }
 
+/*
+ * Helpers for xwii_iface_read_nodes(). During a device scan, each found
+ * interface node, LED and battery is passed to these. Interfaces whose node
+ * changed are closed and re-assigned. Once the scan is done,
+ * xwii_iface_drop_nodes() closes all interfaces that were not found.
+ */
+static void xwii_iface_update_node(struct xwii_iface *dev, int tif,
+				   const char *node)
+{
+	char *n;
+
+	if (dev->ifs[tif].node && !strcmp(node, dev->ifs[tif].node)) {
+		dev->ifs[tif].available = 1;
+		return;
+	} else if (dev->ifs[tif].node) {
+		xwii_iface_close(dev, if_to_iface(tif));
+		free(dev->ifs[tif].node);
+		dev->ifs[tif].node = NULL;
+	}
+
+	n = strdup(node);
+	if (!n)
+		return;
+
+	dev->ifs[tif].node = n;
+	dev->ifs[tif].available = 1;
+}
+
+static void xwii_iface_update_led(struct xwii_iface *dev, const char *path)
+{
+	int ret, len, i;
+
+	len = strlen(path);
+	if (path[len - 1] == '0')
+		i = 0;
+	else if (path[len - 1] == '1')
+		i = 1;
+	else if (path[len - 1] == '2')
+		i = 2;
+	else if (path[len - 1] == '3')
+		i = 3;
+	else
+		return;
+
+	if (dev->led_attrs[i])
+		return;
+
+	ret = asprintf(&dev->led_attrs[i], "%s/%s", path, "brightness");
+	if (ret <= 0)
+		dev->led_attrs[i] = NULL;
+}
+
+static void xwii_iface_update_battery(struct xwii_iface *dev,
+				      const char *path)
+{
+	int ret;
+
+	if (dev->battery_attr)
+		return;
+
+	ret = asprintf(&dev->battery_attr, "%s/%s", path, "capacity");
+	if (ret <= 0)
+		dev->battery_attr = NULL;
+}
+
+static void xwii_iface_drop_nodes(struct xwii_iface *dev)
+{
+	unsigned int ifs;
+	int i;
+
+	/* close no longer available ifaces */
+	ifs = 0;
+	for (i = 0; i < XWII_IF_NUM; ++i) {
+		if (!dev->ifs[i].available && dev->ifs[i].node) {
+			free(dev->ifs[i].node);
+			dev->ifs[i].node = NULL;
+			ifs |= if_to_iface(i);
+		}
+	}
+	xwii_iface_close(dev, ifs);
+}
+
+#ifdef HAVE_UDEV
+
 /*
  * Scan the device \dev for child input devices and update our device-node
  * cache with the new information. This is called during device setup to
@@ -188,9 +478,7 @@ static int xwii_iface_read_nodes(struct xwii_iface *dev)
 	struct udev_list_entry *list;
 	struct udev_device *d;
 	const char *name, *node, *subs;
-	char *n;
-	int ret, prev_if, tif, len, i;
-	unsigned int ifs;
+	int ret, prev_if, tif, i;
 
 	e = udev_enumerate_new(dev->udev);
 	if (!e)
@@ -252,70 +540,213 @@ static int xwii_iface_read_nodes(struct xwii_iface *dev)
 				if (!node)
 					continue;
 
-				if (dev->ifs[tif].node &&
-				    !strcmp(node, dev->ifs[tif].node)) {
-					dev->ifs[tif].available = 1;
-					continue;
-				} else if (dev->ifs[tif].node) {
-					xwii_iface_close(dev,
-							 if_to_iface(tif));
-					free(dev->ifs[tif].node);
-					dev->ifs[tif].node = NULL;
-				}
-
-				n = strdup(node);
-				if (!n)
-					continue;
-
-				dev->ifs[tif].node = n;
-				dev->ifs[tif].available = 1;
+				xwii_iface_update_node(dev, tif, node);
 			}
 		} else if (!strcmp(subs, "leds")) {
-			len = strlen(name);
-			if (name[len - 1] == '0')
-				i = 0;
-			else if (name[len - 1] == '1')
-				i = 1;
-			else if (name[len - 1] == '2')
-				i = 2;
-			else if (name[len - 1] == '3')
-				i = 3;
-			else
-				continue;
+			xwii_iface_update_led(dev, name);
+		} else if (!strcmp(subs, "power_supply")) {
+			xwii_iface_update_battery(dev, name);
+		}
+	}
+
+	udev_enumerate_unref(e);
+	xwii_iface_drop_nodes(dev);
+	dev->scanned = 1;
+
+	return 0;
+}
+
+/* attach \dev to the udev device at \syspath and validate it */
+static int xwii_iface_attach(struct xwii_iface *dev, const char *syspath)
+{
+	const char *driver, *subs;
+	int ret;
+
+	dev->udev = udev_new();
+	if (!dev->udev)
+		return -ENOMEM;
+
+	dev->dev = udev_device_new_from_syspath(dev->udev, syspath);
+	if (!dev->dev) {
+		ret = -ENODEV;
+		goto err_udev;
+	}
+
+	driver = udev_device_get_driver(dev->dev);
+	subs = udev_device_get_subsystem(dev->dev);
+	if (!driver || strcmp(driver, "wiimote") ||
+	    !subs || strcmp(subs, "hid")) {
+		ret = -ENODEV;
+		goto err_dev;
+	}
+
+	return 0;
+
+err_dev:
+	udev_device_unref(dev->dev);
+err_udev:
+	udev_unref(dev->udev);
+	return ret;
+}
+
+static void xwii_iface_detach(struct xwii_iface *dev)
+{
+	udev_device_unref(dev->dev);
+	udev_unref(dev->udev);
+}
+
+#else /* HAVE_UDEV */
+
+/* find the eventX child of the input device \path and store its node */
+static int read_evdev_node(const char *path, char *node, size_t size)
+{
+	char sub[PATH_MAX], name[PATH_MAX];
+	struct dirent *ent;
+	DIR *d;
+	int ret;
+
+	d = opendir(path);
+	if (!d)
+		return -errno;
+
+	ret = -ENODEV;
+	while ((ent = readdir(d))) {
+		if (strncmp(ent->d_name, "event", 5))
+			continue;
+
+		ret = snprintf(sub, sizeof(sub), "%s/%s", path, ent->d_name);
+		if (ret < 0 || ret >= sizeof(sub)) {
+			ret = -ENODEV;
+			continue;
+		}
+
+		ret = xwii__sysfs_read_uevent(sub, "DEVNAME", name,
+					      sizeof(name));
+		if (ret)
+			continue;
 
-			if (dev->led_attrs[i])
+		if (xwii__sysfs_fake())
+			ret = snprintf(node, size, "%s/dev/%s",
+				       xwii__sysfs_root(), name);
+		else
+			ret = snprintf(node, size, "/dev/%s", name);
+		ret = (ret < 0 || ret >= size) ? -ENODEV : 0;
+		break;
+	}
+
+	closedir(d);
+	return ret;
+}
+
+/*
+ * Sysfs variant of the device scan. Same semantics as the udev variant, but
+ * we walk the input/, leds/ and power_supply/ directories of the HID device
+ * directly. Missing directories simply mean that no such child exists.
+ */
+static int xwii_iface_read_nodes(struct xwii_iface *dev)
+{
+	static const char *subsystems[] = { "input", "leds", "power_supply" };
+	char dir[PATH_MAX], path[PATH_MAX], buf[256], node[PATH_MAX];
+	struct dirent *ent;
+	DIR *d;
+	int ret, tif, i, j;
+
+	for (i = 0; i < XWII_IF_NUM; ++i)
+		dev->ifs[i].available = 0;
+
+	for (j = 0; j < 3; ++j) {
+		ret = snprintf(dir, sizeof(dir), "%s/%s", dev->syspath,
+			       subsystems[j]);
+		if (ret < 0 || ret >= sizeof(dir))
+			continue;
+
+		d = opendir(dir);
+		if (!d)
+			continue;
+
+		while ((ent = readdir(d))) {
+			if (ent->d_name[0] == '.')
 				continue;
 
-			ret = asprintf(&dev->led_attrs[i], "%s/%s",
-				       name, "brightness");
-			if (ret <= 0)
-				dev->led_attrs[i] = NULL;
-		} else if (!strcmp(subs, "power_supply")) {
-			if (dev->battery_attr)
+			ret = snprintf(path, sizeof(path), "%s/%s", dir,
+				       ent->d_name);
+			if (ret < 0 || ret >= sizeof(path))
 				continue;
-			ret = asprintf(&dev->battery_attr, "%s/%s",
-				       name, "capacity");
-			if (ret <= 0)
-				dev->battery_attr = NULL;
+
+			if (j == 0) {
+				if (strncmp(ent->d_name, "input", 5))
+					continue;
+
+				ret = xwii__sysfs_read_attr(path, "name", buf,
+							    sizeof(buf));
+				if (ret)
+					continue;
+
+				tif = name_to_if(buf);
+				if (tif < 0)
+					continue;
+
+				ret = read_evdev_node(path, node,
+						      sizeof(node));
+				if (ret)
+					continue;
+
+				xwii_iface_update_node(dev, tif, node);
+			} else if (j == 1) {
+				xwii_iface_update_led(dev, path);
+			} else {
+				xwii_iface_update_battery(dev, path);
+			}
 		}
+
+		closedir(d);
 	}
 
-	udev_enumerate_unref(e);
+	xwii_iface_drop_nodes(dev);
+	dev->scanned = 1;
 
-	/* close no longer available ifaces */
-	ifs = 0;
-	for (i = 0; i < XWII_IF_NUM; ++i) {
-		if (!dev->ifs[i].available && dev->ifs[i].node) {
-			free(dev->ifs[i].node);
-			dev->ifs[i].node = NULL;
-			ifs |= if_to_iface(i);
-		}
+	return 0;
+}
+
+/* attach \dev to the sysfs device at \syspath and validate it */
+static int xwii_iface_attach(struct xwii_iface *dev, const char *syspath)
+{
+	const char *root = xwii__sysfs_root();
+	size_t len = strlen(root);
+
+	dev->syspath = realpath(syspath, NULL);
+	if (!dev->syspath)
+		return -ENODEV;
+
+	if (strncmp(dev->syspath, root, len) || dev->syspath[len] != '/' ||
+	    !xwii__sysfs_is_wiimote(dev->syspath)) {
+		free(dev->syspath);
+		return -ENODEV;
 	}
-	xwii_iface_close(dev, ifs);
 
 	return 0;
 }
 
+static void xwii_iface_detach(struct xwii_iface *dev)
+{
+	free(dev->syspath);
+}
+
+#endif /* HAVE_UDEV */
+
+/*
+ * Objects created with XWII_NEW_LAZY are not scanned for interfaces during
+ * construction. Everything that needs the node or attribute cache calls this
+ * first to perform the initial scan on demand.
+ */
+static int xwii_iface_scan(struct xwii_iface *dev)
+{
+	if (dev->scanned)
+		return 0;
+
+	return xwii_iface_read_nodes(dev);
+}
+
 /*
  * Create new interface structure
  * This creates a new interface for a single Wii Remote device. \syspath must
@@ -328,10 +759,10 @@ static int xwii_iface_read_nodes(struct xwii_iface *dev)
  * Initial refcount is 1 so you need to call *_unref() to free the device.
  */
 XWII__EXPORT
-int xwii_iface_new(struct xwii_iface **dev, const char *syspath)
+int xwii_iface_new_flags(struct xwii_iface **dev, const char *syspath,
+			 unsigned int flags)
 {
 	struct xwii_iface *d;
-	const char *driver, *subs;
 	int ret, i;
 
 	if (!dev || !syspath)
@@ -345,6 +776,11 @@ int xwii_iface_new(struct xwii_iface **dev, const char *syspath)
 	d->ref = 1;
 	d->rumble_id = -1;
 	d->rumble_fd = -1;
+	d->demand_fd = -1;
+	d->mp_rest_gyro = XWII__MP_REST_GYRO * XWII__MP_REST_GYRO;
+	d->mp_rest_accel = XWII__MP_REST_ACCEL * XWII__MP_REST_ACCEL;
+	xwii__accel_init(&d->accel);
+	memcpy(d->sched_rank, if_rank_table, sizeof(d->sched_rank));
 
 	for (i = 0; i < XWII_IF_NUM; ++i)
 		d->ifs[i].fd = -1;
@@ -355,52 +791,21 @@ int xwii_iface_new(struct xwii_iface **dev, const char *syspath)
 		goto err_free;
 	}
 
-	d->udev = udev_new();
-	if (!d->udev) {
-		ret = -ENOMEM;
+	ret = xwii_iface_attach(d, syspath);
+	if (ret)
 		goto err_efd;
-	}
-
-	d->dev = udev_device_new_from_syspath(d->udev, syspath);
-	if (!d->dev) {
-		ret = -ENODEV;
-		goto err_udev;
-	}
-
-	driver = udev_device_get_driver(d->dev);
-	subs = udev_device_get_subsystem(d->dev);
-	if (!driver || strcmp(driver, "wiimote") ||
-	    !subs || strcmp(subs, "hid")) {
-		ret = -ENODEV;
-		goto err_dev;
-	}
-
-	ret = asprintf(&d->devtype_attr, "%s/%s", syspath, "devtype");
-	if (ret <= 0) {
-		ret = -ENOMEM;
-		goto err_dev;
-	}
 
-	ret = asprintf(&d->extension_attr, "%s/%s", syspath, "extension");
-	if (ret <= 0) {
-		ret = -ENOMEM;
-		goto err_attrs;
+	if (!(flags & XWII_NEW_LAZY)) {
+		ret = xwii_iface_read_nodes(d);
+		if (ret)
+			goto err_dev;
 	}
 
-	ret = xwii_iface_read_nodes(d);
-	if (ret)
-		goto err_attrs;
-
 	*dev = d;
 	return 0;
 
-err_attrs:
-	free(d->extension_attr);
-	free(d->devtype_attr);
 err_dev:
-	udev_device_unref(d->dev);
-err_udev:
-	udev_unref(d->udev);
+	xwii_iface_detach(d);
 err_efd:
 	close(d->efd);
 err_free:
@@ -408,6 +813,12 @@ err_free:
 	return ret;
 }
 
+XWII__EXPORT
+int xwii_iface_new(struct xwii_iface **dev, const char *syspath)
+{
+	return xwii_iface_new_flags(dev, syspath, 0);
+}
+
 XWII__EXPORT
 void xwii_iface_ref(struct xwii_iface *dev)
 {
@@ -433,12 +844,16 @@ void xwii_iface_unref(struct xwii_iface *dev)
 	for (i = 0; i < 4; ++i)
 		free(dev->led_attrs[i]);
 	free(dev->battery_attr);
-	free(dev->extension_attr);
-	free(dev->devtype_attr);
 
-	udev_device_unref(dev->dev);
-	udev_unref(dev->udev);
+	if (dev->demand_fd >= 0)
+		close(dev->demand_fd);
+	xwii_iface_detach(dev);
 	close(dev->efd);
+	xwii__gesture_free(dev->gesture);
+	xwii__history_free(dev->history_accel);
+	xwii__history_free(dev->history_ir);
+	xwii__history_free(dev->history_mp);
+	xwii__recorder_free(dev->recorder);
 	free(dev);
 }
 
@@ -448,7 +863,11 @@ const char *xwii_iface_get_syspath(struct xwii_iface *dev)
 	if (!dev)
 		return NULL;
 
+#ifdef HAVE_UDEV
 	return udev_device_get_syspath(dev->dev);
+#else
+	return dev->syspath;
+#endif
 }
 
 XWII__EXPORT
@@ -460,6 +879,8 @@ int xwii_iface_get_fd(struct xwii_iface *dev)
 	return dev->efd;
 }
 
+#ifdef HAVE_UDEV
+
 XWII__EXPORT
 int xwii_iface_watch(struct xwii_iface *dev, bool watch)
 {
@@ -544,40 +965,104 @@ err_mon:
 	return ret;
 }
 
-static int xwii_iface_open_if(struct xwii_iface *dev, unsigned int tif,
-			      bool wr)
+#else /* HAVE_UDEV */
+
+XWII__EXPORT
+int xwii_iface_watch(struct xwii_iface *dev, bool watch)
 {
-	char name[256];
+	int fd, ret;
 	struct epoll_event ep;
-	unsigned int flags;
-	int fd, err;
 
-	if (dev->ifs[tif].fd >= 0)
-		return 0;
-	if (!dev->ifs[tif].node)
-		return -ENODEV;
+	if (!dev)
+		return -EINVAL;
 
-	flags = O_NONBLOCK | O_CLOEXEC;
-	flags |= wr ? O_RDWR : O_RDONLY;
-	fd = open(dev->ifs[tif].node, flags);
-	if (fd < 0)
-		return -errno;
+	if (!watch) {
+		/* remove device watch descriptor */
 
-	if (ioctl(fd, EVIOCGNAME(sizeof(name)), name) < 0) {
-		close(fd);
-		return -errno;
-	}
+		if (!dev->umon)
+			return 0;
 
-	name[sizeof(name) - 1] = 0;
-	if (strcmp(if_to_name_table[tif], name)) {
-		close(fd);
-		return -ENODEV;
+		fd = xwii__umon_get_fd(dev->umon);
+		epoll_ctl(dev->efd, EPOLL_CTL_DEL, fd, NULL);
+		xwii__umon_unref(dev->umon);
+		dev->umon = NULL;
+		return 0;
 	}
 
-	memset(&ep, 0, sizeof(ep));
-	ep.events = EPOLLIN;
-	ep.data.ptr = &dev->ifs[tif];
-	if (epoll_ctl(dev->efd, EPOLL_CTL_ADD, fd, &ep) < 0) {
+	/* add device watch descriptor */
+
+	if (dev->umon)
+		return 0;
+
+	dev->umon = xwii__umon_new();
+	if (!dev->umon)
+		return -ENOMEM;
+
+	fd = xwii__umon_get_fd(dev->umon);
+
+	memset(&ep, 0, sizeof(ep));
+	ep.events = EPOLLIN;
+	ep.data.ptr = dev->umon;
+
+	ret = epoll_ctl(dev->efd, EPOLL_CTL_ADD, fd, &ep);
+	if (ret) {
+		ret = -errno;
+		xwii__umon_unref(dev->umon);
+		dev->umon = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+#endif /* HAVE_UDEV */
+
+static int xwii_iface_open_if(struct xwii_iface *dev, unsigned int tif,
+			      bool wr)
+{
+	char name[256];
+	struct epoll_event ep;
+	unsigned int flags;
+	int fd, err;
+
+	if (dev->ifs[tif].fd >= 0)
+		return 0;
+	if (!dev->ifs[tif].node)
+		return -ENODEV;
+
+	flags = O_NONBLOCK | O_CLOEXEC;
+	flags |= wr ? O_RDWR : O_RDONLY;
+	fd = open(dev->ifs[tif].node, flags);
+	if (fd < 0)
+		return -errno;
+
+	if (ioctl(fd, EVIOCGNAME(sizeof(name)), name) < 0) {
+		/* FIFOs of fake sysfs trees have no name, see sysfs.h */
+		if (errno != ENOTTY || !xwii__sysfs_fake()) {
+			err = -errno;
+			close(fd);
+			return err;
+		}
+		snprintf(name, sizeof(name), "%s", if_to_name_table[tif]);
+	}
+
+	name[sizeof(name) - 1] = 0;
+	if (strcmp(if_to_name_table[tif], name)) {
+		close(fd);
+		return -ENODEV;
+	}
+
+	/* allocate here, so recording never allocates while reading */
+	if (dev->recorder && xwii__recorder_add(dev->recorder,
+						recorder_slot(tif))) {
+		close(fd);
+		return -ENOMEM;
+	}
+
+	memset(&ep, 0, sizeof(ep));
+	ep.events = EPOLLIN;
+	ep.data.ptr = &dev->ifs[tif];
+	if (epoll_ctl(dev->efd, EPOLL_CTL_ADD, fd, &ep) < 0) {
 		err = -errno;
 		close(fd);
 		return err;
@@ -607,11 +1092,66 @@ static void xwii_iface_upload_rumble(struct xwii_iface *dev, int fd)
 	}
 }
 
+static uint64_t xwii_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * On-demand interfaces
+ * The kernel only enables accelerometer, IR and MP reporting while the
+ * related evdev node is open. To reduce the report size and rate on the
+ * bluetooth link, these interfaces can be managed on demand: they are opened
+ * by xwii_iface_demand() and closed again if no demand was signaled within
+ * the idle window. Each event read from such an interface counts as demand,
+ * too. Subscribed interfaces are never closed. The demand_fd timer is armed
+ * for the earliest deadline of all open on-demand interfaces; deadlines that
+ * moved on since are re-checked when it fires.
+ */
+static void xwii_iface_arm_demand(struct xwii_iface *dev)
+{
+	struct itimerspec its;
+	uint64_t next;
+	unsigned int i, iface;
+	bool armed;
+
+	if (dev->demand_fd < 0)
+		return;
+
+	next = 0;
+	armed = false;
+	for (i = 0; i < XWII_IF_NUM; ++i) {
+		iface = if_to_iface(i);
+		if (!(dev->demand_ifaces & iface) ||
+		    (dev->demand_subscribed & iface) ||
+		    !(dev->ifaces & iface))
+			continue;
+		if (!armed || dev->ifs[i].demand_until < next)
+			next = dev->ifs[i].demand_until;
+		armed = true;
+	}
+
+	/* a zero expiration disarms the timer; expired deadlines fire now */
+	memset(&its, 0, sizeof(its));
+	if (armed) {
+		its.it_value.tv_sec = next / 1000000000ULL;
+		its.it_value.tv_nsec = next % 1000000000ULL;
+		if (!next)
+			its.it_value.tv_nsec = 1;
+	}
+	timerfd_settime(dev->demand_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
 XWII__EXPORT
 int xwii_iface_open(struct xwii_iface *dev, unsigned int ifaces)
 {
 	bool wr;
 	int ret, err;
+	uint64_t now, until;
+	unsigned int i;
 
 	if (!dev)
 		return -EINVAL;
@@ -622,6 +1162,10 @@ int xwii_iface_open(struct xwii_iface *dev, unsigned int ifaces)
 	if (!ifaces)
 		return 0;
 
+	ret = xwii_iface_scan(dev);
+	if (ret)
+		return ret;
+
 	err = 0;
 	if (ifaces & XWII_IFACE_CORE) {
 		ret = xwii_iface_open_if(dev, XWII_IF_CORE, wr);
@@ -709,6 +1253,18 @@ int xwii_iface_open(struct xwii_iface *dev, unsigned int ifaces)
 			err = ret;
 	}
 
+	/* on-demand interfaces opened directly start a new idle window */
+	ifaces &= dev->ifaces & dev->demand_ifaces;
+	if (ifaces) {
+		now = xwii_now();
+		until = now + dev->demand_idle;
+		for (i = 0; i < XWII_IF_NUM; ++i)
+			if ((ifaces & if_to_iface(i)) &&
+			    dev->ifs[i].demand_until < now)
+				dev->ifs[i].demand_until = until;
+		xwii_iface_arm_demand(dev);
+	}
+
 	return err;
 }
 
@@ -720,6 +1276,7 @@ static void xwii_iface_close_if(struct xwii_iface *dev, unsigned int tif)
 	epoll_ctl(dev->efd, EPOLL_CTL_DEL, dev->ifs[tif].fd, NULL);
 	close(dev->ifs[tif].fd);
 	dev->ifs[tif].fd = -1;
+	dev->ifs[tif].peeked = 0;
 }
 
 XWII__EXPORT
@@ -780,7 +1337,7 @@ unsigned int xwii_iface_available(struct xwii_iface *dev)
 {
 	unsigned int ifs = 0, i;
 
-	if (!dev)
+	if (!dev || xwii_iface_scan(dev))
 		return 0;
 
 	for (i = 0; i < XWII_IF_NUM; ++i)
@@ -789,6 +1346,319 @@ unsigned int xwii_iface_available(struct xwii_iface *dev)
 	return ifs;
 }
 
+static int read_demand(struct xwii_iface *dev, struct epoll_event *ep,
+		       struct xwii_event *ev)
+{
+	uint64_t exp, now;
+	unsigned int i, iface, ifs;
+
+	if (read(dev->demand_fd, &exp, sizeof(exp)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	now = xwii_now();
+	ifs = 0;
+	for (i = 0; i < XWII_IF_NUM; ++i) {
+		iface = if_to_iface(i);
+		if ((dev->demand_ifaces & iface) &&
+		    !(dev->demand_subscribed & iface) &&
+		    dev->ifs[i].demand_until <= now)
+			ifs |= iface;
+	}
+
+	/* closing is part of the policy, so no XWII_EVENT_WATCH is sent */
+	xwii_iface_close(dev, ifs & dev->ifaces);
+	xwii_iface_arm_demand(dev);
+
+	return -EAGAIN;
+}
+
+XWII__EXPORT
+int xwii_iface_set_demand_policy(struct xwii_iface *dev, unsigned int ifaces,
+				 unsigned int idle_ms)
+{
+	struct epoll_event ep;
+	uint64_t until;
+	unsigned int i;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if ((ifaces & XWII_IFACE_ALL) && dev->demand_fd < 0) {
+		dev->demand_fd = timerfd_create(CLOCK_MONOTONIC,
+						TFD_NONBLOCK | TFD_CLOEXEC);
+		if (dev->demand_fd < 0)
+			return -errno;
+
+		memset(&ep, 0, sizeof(ep));
+		ep.events = EPOLLIN;
+		ep.data.ptr = &dev->demand_fd;
+		if (epoll_ctl(dev->efd, EPOLL_CTL_ADD, dev->demand_fd,
+			      &ep) < 0) {
+			ret = -errno;
+			close(dev->demand_fd);
+			dev->demand_fd = -1;
+			return ret;
+		}
+	}
+
+	dev->demand_ifaces = ifaces & (XWII_IFACE_ALL | XWII_IFACE_WRITABLE);
+	dev->demand_subscribed &= ifaces;
+	dev->demand_idle = idle_ms * 1000000ULL;
+
+	/* interfaces that are already open start with a full idle window */
+	until = xwii_now() + dev->demand_idle;
+	for (i = 0; i < XWII_IF_NUM; ++i)
+		if (dev->demand_ifaces & dev->ifaces & if_to_iface(i))
+			dev->ifs[i].demand_until = until;
+	xwii_iface_arm_demand(dev);
+
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_demand(struct xwii_iface *dev, unsigned int ifaces)
+{
+	uint64_t until;
+	unsigned int i;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	ifaces &= dev->demand_ifaces & XWII_IFACE_ALL;
+	if (!ifaces)
+		return 0;
+
+	until = xwii_now() + dev->demand_idle;
+	for (i = 0; i < XWII_IF_NUM; ++i)
+		if (ifaces & if_to_iface(i))
+			dev->ifs[i].demand_until = until;
+
+	ret = xwii_iface_open(dev, ifaces |
+				   (dev->demand_ifaces & XWII_IFACE_WRITABLE));
+	xwii_iface_arm_demand(dev);
+
+	return ret;
+}
+
+XWII__EXPORT
+int xwii_iface_subscribe(struct xwii_iface *dev, unsigned int ifaces,
+			 bool subscribe)
+{
+	uint64_t until;
+	unsigned int i;
+
+	if (!dev)
+		return -EINVAL;
+
+	ifaces &= dev->demand_ifaces & XWII_IFACE_ALL;
+	if (subscribe) {
+		dev->demand_subscribed |= ifaces;
+		return xwii_iface_demand(dev, ifaces);
+	}
+
+	/* unsubscribed interfaces stay open for one more idle window */
+	dev->demand_subscribed &= ~ifaces;
+	until = xwii_now() + dev->demand_idle;
+	for (i = 0; i < XWII_IF_NUM; ++i)
+		if (ifaces & if_to_iface(i))
+			dev->ifs[i].demand_until = until;
+	xwii_iface_arm_demand(dev);
+
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_auto_open(struct xwii_iface *dev, unsigned int ifaces)
+{
+	if (!dev)
+		return;
+
+	dev->auto_ifaces = ifaces & (XWII_IFACE_ALL | XWII_IFACE_WRITABLE);
+}
+
+/*
+ * Rescan the device after a hotplug event or after the kernel closed one of
+ * our interfaces. Interfaces in the auto-open mask that became available are
+ * reopened right away so no round-trip to the application is needed. On-demand
+ * interfaces are only reopened while they are demanded.
+ */
+static void xwii_iface_hotplug(struct xwii_iface *dev)
+{
+	unsigned int ifs, i, iface;
+	uint64_t now;
+
+	xwii_iface_read_nodes(dev);
+
+	ifs = dev->auto_ifaces & XWII_IFACE_ALL & ~dev->ifaces;
+	if (!ifs)
+		return;
+
+	now = xwii_now();
+	for (i = 0; i < XWII_IF_NUM; ++i) {
+		iface = if_to_iface(i);
+		if (!dev->ifs[i].node)
+			ifs &= ~iface;
+		else if ((dev->demand_ifaces & iface) &&
+			 !(dev->demand_subscribed & iface) &&
+			 dev->ifs[i].demand_until <= now)
+			ifs &= ~iface;
+	}
+	if (!ifs)
+		return;
+
+	xwii_iface_open(dev, ifs | (dev->auto_ifaces & XWII_IFACE_WRITABLE));
+
+	for (i = 0; i < XWII_IF_NUM; ++i) {
+		if (ifs & dev->ifaces & if_to_iface(i)) {
+			dev->ifs[i].reopened = 1;
+			++dev->stats.reopen_count;
+		}
+	}
+}
+
+/*
+ * Called for each event read from interface \tif. If the interface was
+ * reopened automatically, the gap between the last event before and the first
+ * event after the hotplug is recorded. Both are kernel timestamps.
+ */
+static void xwii_iface_account(struct xwii_iface *dev, unsigned int tif,
+			       const struct xwii_event *ev)
+{
+	struct xwii_if *xif = &dev->ifs[tif];
+	int64_t gap;
+
+	if (xif->reopened) {
+		xif->reopened = 0;
+		if (xif->last.tv_sec || xif->last.tv_usec) {
+			gap = (ev->time.tv_sec - xif->last.tv_sec) * 1000000LL +
+			      (ev->time.tv_usec - xif->last.tv_usec);
+			if (gap < 0)
+				gap = 0;
+			dev->stats.reopen_gap_last = gap;
+			dev->stats.reopen_gap_total += gap;
+			++dev->stats.reopen_gap_num;
+			if (gap > dev->stats.reopen_gap_max)
+				dev->stats.reopen_gap_max = gap;
+		}
+	}
+
+	xif->last = ev->time;
+}
+
+XWII__EXPORT
+int xwii_iface_get_stats(struct xwii_iface *dev,
+			 struct xwii_iface_stats *stats, size_t size)
+{
+	if (!dev || !stats)
+		return -EINVAL;
+	if (size > sizeof(dev->stats))
+		size = sizeof(dev->stats);
+
+	memcpy(stats, &dev->stats, size);
+	return 0;
+}
+
+/* shared state of xwii_iface_new_many() workers */
+struct xwii_bulk {
+	struct xwii_iface **devs;
+	int *errs;
+	const char *const *syspaths;
+	size_t num;
+	unsigned int ifaces;
+	size_t next;
+};
+
+static void *xwii_bulk_worker(void *data)
+{
+	struct xwii_bulk *b = data;
+	struct xwii_iface *dev;
+	size_t i;
+	int ret;
+
+	while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) <
+	       b->num) {
+		b->devs[i] = NULL;
+		ret = xwii_iface_new(&dev, b->syspaths[i]);
+		if (!ret) {
+			b->devs[i] = dev;
+			if (b->ifaces & XWII_IFACE_ALL)
+				ret = xwii_iface_open(dev, b->ifaces);
+		}
+		b->errs[i] = ret;
+	}
+
+	return NULL;
+}
+
+/*
+ * Devices do not share any state, so each one can be created and opened on a
+ * separate thread. The calling thread takes part in the work, so if no
+ * helper thread can be spawned, this degrades to the serial behavior.
+ */
+XWII__EXPORT
+int xwii_iface_new_many(struct xwii_iface **devs, int *errs,
+			const char *const *syspaths, size_t num,
+			unsigned int ifaces, unsigned int threads)
+{
+	struct xwii_bulk b;
+	pthread_t tids[XWII_BULK_MAX_THREADS];
+	unsigned int i, spawned;
+	size_t j;
+	int ret;
+
+	if (!devs || !errs || !syspaths)
+		return -EINVAL;
+
+	if (!threads)
+		threads = XWII_BULK_DEFAULT_THREADS;
+	if (threads > XWII_BULK_MAX_THREADS)
+		threads = XWII_BULK_MAX_THREADS;
+	if (threads > num)
+		threads = num;
+
+	b.devs = devs;
+	b.errs = errs;
+	b.syspaths = syspaths;
+	b.num = num;
+	b.ifaces = ifaces;
+	b.next = 0;
+
+	spawned = 0;
+	for (i = 1; i < threads; ++i) {
+		if (pthread_create(&tids[spawned], NULL, xwii_bulk_worker, &b))
+			break;
+		++spawned;
+	}
+
+	xwii_bulk_worker(&b);
+
+	for (i = 0; i < spawned; ++i)
+		pthread_join(tids[i], NULL);
+
+	ret = 0;
+	for (j = 0; j < num; ++j)
+		if (devs[j])
+			++ret;
+
+	return ret;
+}
+
+/*
+ * Clear \ev before a read path fills it. Compact dispatch only reads the
+ * payload fields each read path sets, so only the header is cleared then.
+ */
+static inline void event_clear(struct xwii_iface *dev, struct xwii_event *ev)
+{
+	if (dev->compact)
+		memset(ev, 0, offsetof(struct xwii_event, v));
+	else
+		memset(ev, 0, sizeof(*ev));
+}
+
+#ifdef HAVE_UDEV
+
 static int read_umon(struct xwii_iface *dev, struct epoll_event *ep,
 		     struct xwii_event *ev)
 {
@@ -838,17 +1708,17 @@ static int read_umon(struct xwii_iface *dev, struct epoll_event *ep,
 
 		/* notify caller of removals via special event */
 		if (remove) {
-			memset(ev, 0, sizeof(*ev));
+			event_clear(dev, ev);
 			ev->type = XWII_EVENT_GONE;
-			xwii_iface_read_nodes(dev);
+			xwii_iface_hotplug(dev);
 			return 0;
 		}
 
 		/* notify caller via generic hotplug event */
 		if (hotplug) {
-			memset(ev, 0, sizeof(*ev));
+			event_clear(dev, ev);
 			ev->type = XWII_EVENT_WATCH;
-			xwii_iface_read_nodes(dev);
+			xwii_iface_hotplug(dev);
 			return 0;
 		}
 	}
@@ -859,40 +1729,142 @@ static int read_umon(struct xwii_iface *dev, struct epoll_event *ep,
 	return -EAGAIN;
 }
 
-static int read_event(int fd, struct input_event *ev)
+#else /* HAVE_UDEV */
+
+static int read_umon(struct xwii_iface *dev, struct epoll_event *ep,
+		     struct xwii_event *ev)
 {
-	int ret;
+	struct xwii__uevent uev;
+	const char *path;
+	bool hotplug, remove;
+	size_t len;
 
-	ret = read(fd, ev, sizeof(*ev));
-	if (ret < 0)
-		return -errno;
-	else if (ret == 0)
-		return -EAGAIN;
-	else if (ret != sizeof(*ev))
-		return -EIO;
-	else
-		return 0;
-}
+	if (ep->events & EPOLLIN) {
+		hotplug = false;
+		remove = false;
 
-static int read_core(struct xwii_iface *dev, struct xwii_event *ev)
-{
-	int ret, fd;
-	struct input_event input;
-	unsigned int key;
+		/* uevents carry the DEVPATH without the sysfs mount point */
+		path = dev->syspath + strlen(xwii__sysfs_root());
+		len = strlen(path);
+
+		/* try to merge as many hotplug events as possible; we are
+		 * interested in the same three kinds of events as with udev,
+		 * see the udev variant of read_umon() */
+		while (!xwii__umon_receive(dev->umon, &uev)) {
+			if (!strcmp(uev.devpath, path)) {
+				if (!strcmp(uev.action, "change"))
+					hotplug = true;
+				else if (!strcmp(uev.action, "remove"))
+					remove = true;
+			} else if (!uev.devname && uev.subsystem &&
+				   !strcmp(uev.subsystem, "input") &&
+				   !strncmp(uev.devpath, path, len) &&
+				   uev.devpath[len] == '/') {
+				hotplug = true;
+			}
+		}
 
-	fd = dev->ifs[XWII_IF_CORE].fd;
-	if (fd < 0)
-		return -EAGAIN;
+		/* notify caller of removals via special event */
+		if (remove) {
+			event_clear(dev, ev);
+			ev->type = XWII_EVENT_GONE;
+			xwii_iface_hotplug(dev);
+			return 0;
+		}
+
+		/* notify caller via generic hotplug event */
+		if (hotplug) {
+			event_clear(dev, ev);
+			ev->type = XWII_EVENT_WATCH;
+			xwii_iface_hotplug(dev);
+			return 0;
+		}
+	}
+
+	if (ep->events & (EPOLLHUP | EPOLLERR))
+		return -EPIPE;
+
+	return -EAGAIN;
+}
+
+#endif /* HAVE_UDEV */
+
+/*
+ * queue derived event \ev; if the queue is full, the oldest event is lost and
+ * counted in the statistics
+ */
+static void xwii_iface_push(struct xwii_iface *dev,
+			    const struct xwii_event *ev)
+{
+	unsigned int i;
+
+	if (dev->pending_num == XWII__PENDING_NUM) {
+		dev->pending_first = (dev->pending_first + 1) %
+							XWII__PENDING_NUM;
+		--dev->pending_num;
+		++dev->stats.pending_dropped;
+	}
+
+	i = (dev->pending_first + dev->pending_num) % XWII__PENDING_NUM;
+	memcpy(&dev->pending[i], ev, sizeof(*ev));
+	++dev->pending_num;
+}
+
+/* dequeue the oldest derived event into \ev; returns false if empty */
+static bool xwii_iface_pop(struct xwii_iface *dev, struct xwii_event *ev)
+{
+	if (!dev->pending_num)
+		return false;
+
+	memcpy(ev, &dev->pending[dev->pending_first], sizeof(*ev));
+	dev->pending_first = (dev->pending_first + 1) % XWII__PENDING_NUM;
+	--dev->pending_num;
+	return true;
+}
+
+static int read_event(struct xwii_iface *dev, unsigned int tif,
+		      struct input_event *ev)
+{
+	int ret;
+
+	if (dev->ifs[tif].peeked) {
+		*ev = dev->ifs[tif].peek;
+		dev->ifs[tif].peeked = 0;
+		return 0;
+	}
+
+	ret = read(dev->ifs[tif].fd, ev, sizeof(*ev));
+	if (ret < 0)
+		return -errno;
+	else if (ret == 0)
+		return -EAGAIN;
+	else if (ret != sizeof(*ev))
+		return -EIO;
+
+	if (dev->recorder)
+		xwii__recorder_push(dev->recorder, recorder_slot(tif), ev);
+	return 0;
+}
+
+static int read_core(struct xwii_iface *dev, struct xwii_event *ev)
+{
+	int ret, fd;
+	struct input_event input;
+	unsigned int key;
+
+	fd = dev->ifs[XWII_IF_CORE].fd;
+	if (fd < 0)
+		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_CORE, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_CORE);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -940,7 +1912,7 @@ try_again:
 			goto try_again;
 	}
 
-	memset(ev, 0, sizeof(*ev));
+	event_clear(dev, ev);
 	memcpy(&ev->time, &input.time, sizeof(struct timeval));
 	ev->type = XWII_EVENT_KEY;
 	ev->v.key.code = key;
@@ -948,6 +1920,85 @@ try_again:
 	return 0;
 }
 
+/* feed sample \v into \r; returns true if all variances are below \thr */
+static bool rest_update(struct xwii_rest *r, const struct xwii_event_abs *v,
+			int64_t thr)
+{
+	int64_t val[3] = { v->x, v->y, v->z }, d;
+	bool rest = true;
+	unsigned int i;
+
+	for (i = 0; i < 3; ++i) {
+		if (!r->num) {
+			r->mean[i] = val[i] * 256;
+			r->var[i] = 0;
+		}
+
+		r->mean[i] += (val[i] * 256 - r->mean[i]) >> XWII__REST_SHIFT;
+		d = val[i] - (r->mean[i] >> 8);
+		r->var[i] += (d * d - r->var[i]) >> XWII__REST_SHIFT;
+		if (r->var[i] > thr)
+			rest = false;
+	}
+
+	/* the first few samples only initialize the moving averages */
+	if (r->num < (1U << XWII__REST_SHIFT)) {
+		++r->num;
+		rest = false;
+	}
+
+	return rest;
+}
+
+/*
+ * Apply rate limit \r to the \num abs values of \ev. Returns true and counts
+ * the report if it is to be dropped. Otherwise, averages are written into \ev
+ * if requested.
+ */
+static bool rate_drop(struct xwii_iface *dev, struct xwii_rate *r,
+		      struct xwii_event *ev, unsigned int num)
+{
+	struct xwii_event_abs *abs = ev->v.abs;
+	int64_t t, n;
+	unsigned int i;
+
+	t = ev->time.tv_sec * 1000000LL + ev->time.tv_usec;
+
+	if (r->mode == XWII_RATE_AVERAGE) {
+		for (i = 0; i < num; ++i) {
+			r->sum[i][0] += abs[i].x;
+			r->sum[i][1] += abs[i].y;
+			r->sum[i][2] += abs[i].z;
+		}
+		++r->num;
+	}
+
+	/* the deadline may be too far off if the clock jumped back */
+	if (t < r->next && r->next - t <= r->period) {
+		++dev->stats.rate_dropped;
+		return true;
+	}
+
+	/* keep the cadence unless reports stalled for a whole period */
+	if (r->next && t - r->next < r->period)
+		r->next += r->period;
+	else
+		r->next = t + r->period;
+
+	if (r->mode == XWII_RATE_AVERAGE) {
+		n = r->num;
+		for (i = 0; i < num; ++i) {
+			abs[i].x = r->sum[i][0] / n;
+			abs[i].y = r->sum[i][1] / n;
+			abs[i].z = r->sum[i][2] / n;
+		}
+		r->num = 0;
+		memset(r->sum, 0, sizeof(r->sum));
+	}
+
+	return false;
+}
+
 static int read_accel(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
@@ -958,22 +2009,27 @@ static int read_accel(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_ACCEL, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_ACCEL);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
 	if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(ev->v.abs, &dev->accel_cache, sizeof(dev->accel_cache));
 		ev->type = XWII_EVENT_ACCEL;
+
+		if (dev->mp_bias_rate)
+			dev->accel_resting = rest_update(&dev->accel_rest,
+							 &dev->accel_cache,
+							 dev->mp_rest_accel);
 		return 0;
 	}
 
@@ -990,6 +2046,50 @@ try_again:
 	goto try_again;
 }
 
+/* clamp filtered IR coordinate \v to 0..\max */
+static inline float ir_clamp(float v, float max)
+{
+	if (v < 0.0f)
+		return 0.0f;
+	if (v > max)
+		return max;
+	return v;
+}
+
+/* filter all valid IR slots of \ev in place */
+static void filter_ir(struct xwii_iface *dev, struct xwii_event *ev)
+{
+	struct xwii__filter *f;
+	struct xwii_event_abs *abs;
+	int64_t time;
+	float x, y;
+	unsigned int i;
+
+	time = ev->time.tv_sec * 1000000LL + ev->time.tv_usec;
+
+	for (i = 0; i < 4; ++i) {
+		f = dev->ir_filter_state[i];
+		abs = &ev->v.abs[i];
+		if (!xwii_event_ir_is_valid(abs)) {
+			xwii__filter_reset(&f[0]);
+			xwii__filter_reset(&f[1]);
+			continue;
+		}
+
+		/* slot switched to a different IR source */
+		if (fabsf(abs->x - f[0].x) > XWII__IR_TRACK_DIST ||
+		    fabsf(abs->y - f[1].x) > XWII__IR_TRACK_DIST) {
+			xwii__filter_reset(&f[0]);
+			xwii__filter_reset(&f[1]);
+		}
+
+		x = xwii__filter_update(&f[0], &dev->ir_filter, abs->x, time);
+		y = xwii__filter_update(&f[1], &dev->ir_filter, abs->y, time);
+		abs->x = ir_clamp(x, XWII__IR_WIDTH - 1) + 0.5f;
+		abs->y = ir_clamp(y, XWII__IR_HEIGHT - 1) + 0.5f;
+	}
+}
+
 static int read_ir(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
@@ -1000,22 +2100,25 @@ static int read_ir(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_IR, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_IR);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
 	if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->ir_cache, sizeof(dev->ir_cache));
 		ev->type = XWII_EVENT_IR;
+
+		if (dev->ir_filter.type)
+			filter_ir(dev, ev);
 		return 0;
 	}
 
@@ -1042,6 +2145,51 @@ try_again:
 	goto try_again;
 }
 
+/* round Q8 bias to raw units */
+static inline int32_t mp_bias(int64_t bias)
+{
+	return (bias + 128) >> 8;
+}
+
+/*
+ * Motion-Plus bias estimation
+ * Gyroscopes report a slowly drifting non-zero rate at rest. Whenever the MP
+ * (and the accelerometer, if open) report a low variance for a couple of
+ * consecutive samples, the device is considered at rest and the bias is
+ * moved towards the mean gyro rate by rate/1024. During motion, the bias is
+ * left untouched so sustained rotation does not leak into it. The bias is
+ * estimated on top of the normalization values. Everything is integer-only.
+ */
+static void mp_estimate_bias(struct xwii_iface *dev)
+{
+	const int64_t norm[3] = {
+		dev->mp_normalizer.x * 256LL / 100,
+		dev->mp_normalizer.y * 256LL / 100,
+		dev->mp_normalizer.z * 256LL / 100,
+	};
+	int64_t f = dev->mp_bias_rate;
+	bool rest;
+	unsigned int i;
+
+	rest = rest_update(&dev->mp_rest, &dev->mp_cache, dev->mp_rest_gyro);
+	if (rest && (dev->ifaces & XWII_IFACE_ACCEL))
+		rest = dev->accel_resting;
+
+	if (!rest) {
+		dev->mp_rest_count = 0;
+		return;
+	}
+
+	if (dev->mp_rest_count < XWII__MP_REST_SAMPLES) {
+		++dev->mp_rest_count;
+		return;
+	}
+
+	for (i = 0; i < 3; ++i)
+		dev->mp_bias[i] += ((dev->mp_rest.mean[i] - norm[i] -
+				     dev->mp_bias[i]) * f) >> 10;
+}
+
 static int read_mp(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
@@ -1052,24 +2200,30 @@ static int read_mp(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_MOTION_PLUS, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_MOTION_PLUS);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
 	if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 
-		ev->v.abs[0].x = dev->mp_cache.x - dev->mp_normalizer.x / 100;
-		ev->v.abs[0].y = dev->mp_cache.y - dev->mp_normalizer.y / 100;
-		ev->v.abs[0].z = dev->mp_cache.z - dev->mp_normalizer.z / 100;
+		if (dev->mp_bias_rate)
+			mp_estimate_bias(dev);
+
+		ev->v.abs[0].x = dev->mp_cache.x - dev->mp_normalizer.x / 100 -
+				 mp_bias(dev->mp_bias[0]);
+		ev->v.abs[0].y = dev->mp_cache.y - dev->mp_normalizer.y / 100 -
+				 mp_bias(dev->mp_bias[1]);
+		ev->v.abs[0].z = dev->mp_cache.z - dev->mp_normalizer.z / 100 -
+				 mp_bias(dev->mp_bias[2]);
 		dev->mp_normalizer.x += dev->mp_normalize_factor *
 					((ev->v.abs[0].x > 0) ? 1 : -1);
 		dev->mp_normalizer.y += dev->mp_normalize_factor *
@@ -1094,6 +2248,79 @@ try_again:
 	goto try_again;
 }
 
+static bool deadband_exceeded(int32_t v, int32_t last, int32_t thr)
+{
+	return thr >= 0 && (v - last > thr || last - v > thr);
+}
+
+/*
+ * Check the new values \abs of an interface against its deadband \db. Returns
+ * true and counts the report if it is to be dropped.
+ */
+static bool deadband_drop(struct xwii_iface *dev, struct xwii_deadband *db,
+			  const struct xwii_event_abs *abs)
+{
+	const struct xwii_event_abs *t, *l;
+	unsigned int i;
+
+	if (!db->num)
+		return false;
+
+	if (db->valid) {
+		for (i = 0; i < db->num; ++i) {
+			t = &db->thr[i];
+			l = &db->last[i];
+			if (deadband_exceeded(abs[i].x, l->x, t->x) ||
+			    deadband_exceeded(abs[i].y, l->y, t->y) ||
+			    deadband_exceeded(abs[i].z, l->z, t->z))
+				break;
+		}
+
+		if (i == db->num) {
+			++dev->stats.deadband_dropped;
+			return true;
+		}
+	}
+
+	db->valid = true;
+	memcpy(db->last, abs, db->num * sizeof(*abs));
+	return false;
+}
+
+/*
+ * Run stick processing on the first \num abs values of MOVE event \ev. Fixed
+ * point results replace the raw values in place, float results are queued as
+ * separate event.
+ */
+static void process_sticks(struct xwii_iface *dev, struct xwii__stick *s,
+			   unsigned int iface, unsigned int num,
+			   struct xwii_event *ev)
+{
+	struct xwii_event out;
+	float v[2];
+	unsigned int i;
+
+	memset(&out, 0, sizeof(out));
+	out.time = ev->time;
+	out.type = XWII_EVENT_STICK;
+	out.v.stick.iface = iface;
+	out.v.stick.num = num;
+
+	for (i = 0; i < num; ++i) {
+		xwii__stick_update(s, i, &ev->v.abs[i], v);
+		if (s->mode == XWII_STICK_FIXED) {
+			ev->v.abs[i].x = lrintf(v[0] * XWII_STICK_ONE);
+			ev->v.abs[i].y = lrintf(v[1] * XWII_STICK_ONE);
+		} else {
+			out.v.stick.x[i] = v[0];
+			out.v.stick.y[i] = v[1];
+		}
+	}
+
+	if (s->mode == XWII_STICK_FLOAT)
+		xwii_iface_push(dev, &out);
+}
+
 static int read_nunchuk(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
@@ -1105,14 +2332,14 @@ static int read_nunchuk(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_NUNCHUK, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_NUNCHUK);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -1131,7 +2358,7 @@ try_again:
 				goto try_again;
 		}
 
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		ev->type = XWII_EVENT_NUNCHUK_KEY;
 		ev->v.key.code = key;
@@ -1149,11 +2376,19 @@ try_again:
 		else if (input.code == ABS_RZ)
 			dev->nunchuk_cache[1].z = input.value;
 	} else if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		if (deadband_drop(dev, &dev->nunchuk_deadband,
+				  dev->nunchuk_cache))
+			goto try_again;
+
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->nunchuk_cache,
 		       sizeof(dev->nunchuk_cache));
 		ev->type = XWII_EVENT_NUNCHUK_MOVE;
+
+		if (dev->nunchuk_stick.mode != XWII_STICK_RAW)
+			process_sticks(dev, &dev->nunchuk_stick,
+				       XWII_IFACE_NUNCHUK, 1, ev);
 		return 0;
 	} else {
 	}
@@ -1172,14 +2407,14 @@ static int read_classic(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_CLASSIC_CONTROLLER, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_CLASSIC_CONTROLLER);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -1237,7 +2472,7 @@ try_again:
 				goto try_again;
 		}
 
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		ev->type = XWII_EVENT_CLASSIC_CONTROLLER_KEY;
 		ev->v.key.code = key;
@@ -1257,11 +2492,19 @@ try_again:
 		else if (input.code == ABS_HAT3Y)
 			dev->classic_cache[2].x = input.value;
 	} else if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		if (deadband_drop(dev, &dev->classic_deadband,
+				  dev->classic_cache))
+			goto try_again;
+
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->classic_cache,
 		       sizeof(dev->classic_cache));
 		ev->type = XWII_EVENT_CLASSIC_CONTROLLER_MOVE;
+
+		if (dev->classic_stick.mode != XWII_STICK_RAW)
+			process_sticks(dev, &dev->classic_stick,
+				       XWII_IFACE_CLASSIC_CONTROLLER, 2, ev);
 		return 0;
 	} else {
 	}
@@ -1279,19 +2522,19 @@ static int read_bboard(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_BALANCE_BOARD, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_BALANCE_BOARD);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
 	if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->bboard_cache,
 		       sizeof(dev->bboard_cache));
@@ -1325,14 +2568,14 @@ static int read_pro(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_PRO_CONTROLLER, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_PRO_CONTROLLER);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -1420,7 +2663,7 @@ try_again:
 				goto try_again;
 		}
 
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		ev->type = XWII_EVENT_PRO_CONTROLLER_KEY;
 		ev->v.key.code = key;
@@ -1436,11 +2679,19 @@ try_again:
 		else if (input.code == ABS_RY)
 			dev->pro_cache[1].y = input.value;
 	} else if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		if (deadband_drop(dev, &dev->pro_deadband,
+				  dev->pro_cache))
+			goto try_again;
+
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->pro_cache,
 		       sizeof(dev->pro_cache));
 		ev->type = XWII_EVENT_PRO_CONTROLLER_MOVE;
+
+		if (dev->pro_stick.mode != XWII_STICK_RAW)
+			process_sticks(dev, &dev->pro_stick,
+				       XWII_IFACE_PRO_CONTROLLER, 2, ev);
 		return 0;
 	} else {
 	}
@@ -1452,21 +2703,22 @@ static int read_drums(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
 	struct input_event input;
-	unsigned int key;
+	struct xwii_event hits[XWII_DRUMS_ABS_NUM];
+	unsigned int key, i, n;
 
 	fd = dev->ifs[XWII_IF_DRUMS].fd;
 	if (fd < 0)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_DRUMS, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_DRUMS);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -1485,7 +2737,7 @@ try_again:
 			goto try_again;
 		}
 
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		ev->type = XWII_EVENT_DRUMS_KEY;
 		ev->v.key.code = key;
@@ -1532,17 +2784,60 @@ try_again:
 		else if (input.code == ABS_HI_HAT)
 			dev->drums_cache[XWII_DRUMS_ABS_HI_HAT].x = input.value;
 	} else if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->drums_cache,
 		       sizeof(dev->drums_cache));
 		ev->type = XWII_EVENT_DRUMS_MOVE;
+
+		/* queue hits behind the move event of the same report */
+		if (dev->drums_hits) {
+			n = xwii__drums_update(&dev->drums, ev, hits);
+			for (i = 0; i < n; ++i)
+				xwii_iface_push(dev, &hits[i]);
+		}
 		return 0;
 	}
 
 	goto try_again;
 }
 
+/* track pressed frets and queue a note if the strum bar was hit */
+static void guitar_update(struct xwii_iface *dev, const struct xwii_event *ev)
+{
+	unsigned int code = ev->v.key.code, bit;
+	struct xwii_event note;
+	struct xwii_event_guitar_note *n = &note.v.guitar_note;
+
+	if (code >= XWII_KEY_FRET_FAR_UP && code <= XWII_KEY_FRET_FAR_LOW) {
+		bit = 1U << (code - XWII_KEY_FRET_FAR_UP);
+		if (ev->v.key.state)
+			dev->guitar_frets |= bit;
+		else
+			dev->guitar_frets &= ~bit;
+		return;
+	}
+
+	if (!dev->guitar_notes || ev->v.key.state != 1)
+		return;
+	if (code != XWII_KEY_STRUM_BAR_UP && code != XWII_KEY_STRUM_BAR_DOWN)
+		return;
+
+	/* the kernel reports frets and axes before the strum bar */
+	memset(&note, 0, sizeof(note));
+	note.time = ev->time;
+	note.type = XWII_EVENT_GUITAR_NOTE;
+	n->frets = dev->guitar_frets;
+	n->strum = code;
+	n->whammy = dev->guitar_cache[1].x;
+	n->whammy_delta = n->whammy - dev->guitar_whammy;
+	n->slider = dev->guitar_cache[2].x;
+	n->slider_delta = n->slider - dev->guitar_slider;
+	dev->guitar_whammy = n->whammy;
+	dev->guitar_slider = n->slider;
+	xwii_iface_push(dev, &note);
+}
+
 static int read_guitar(struct xwii_iface *dev, struct xwii_event *ev)
 {
 	int ret, fd;
@@ -1554,14 +2849,14 @@ static int read_guitar(struct xwii_iface *dev, struct xwii_event *ev)
 		return -EAGAIN;
 
 try_again:
-	ret = read_event(fd, &input);
+	ret = read_event(dev, XWII_IF_GUITAR, &input);
 	if (ret == -EAGAIN) {
 		return -EAGAIN;
 	} else if (ret < 0) {
 		xwii_iface_close(dev, XWII_IFACE_GUITAR);
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		ev->type = XWII_EVENT_WATCH;
-		xwii_iface_read_nodes(dev);
+		xwii_iface_hotplug(dev);
 		return 0;
 	}
 
@@ -1622,11 +2917,13 @@ try_again:
 			goto try_again;
 		}
 
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		ev->type = XWII_EVENT_GUITAR_KEY;
 		ev->v.key.code = key;
 		ev->v.key.state = input.value;
+
+		guitar_update(dev, ev);
 		return 0;
 	} else if (input.type == EV_ABS) {
 		if (input.code == ABS_X)
@@ -1644,7 +2941,7 @@ try_again:
 		else if (input.code == ABS_FRET_BOARD)
 			dev->guitar_cache[2].x = input.value;
 	} else if (input.type == EV_SYN) {
-		memset(ev, 0, sizeof(*ev));
+		event_clear(dev, ev);
 		memcpy(&ev->time, &input.time, sizeof(struct timeval));
 		memcpy(&ev->v.abs, dev->guitar_cache,
 		       sizeof(dev->guitar_cache));
@@ -1655,94 +2952,384 @@ try_again:
 	goto try_again;
 }
 
-static int dispatch_event(struct xwii_iface *dev, struct epoll_event *ep,
-			  struct xwii_event *ev)
+static int read_if(struct xwii_iface *dev, unsigned int tif,
+		   struct xwii_event *ev)
 {
-	if (dev->umon && ep->data.ptr == dev->umon)
-		return read_umon(dev, ep, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_CORE])
+	switch (tif) {
+	case XWII_IF_CORE:
 		return read_core(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_ACCEL])
+	case XWII_IF_ACCEL:
 		return read_accel(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_IR])
+	case XWII_IF_IR:
 		return read_ir(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_MOTION_PLUS])
+	case XWII_IF_MOTION_PLUS:
 		return read_mp(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_NUNCHUK])
+	case XWII_IF_NUNCHUK:
 		return read_nunchuk(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_CLASSIC_CONTROLLER])
+	case XWII_IF_CLASSIC_CONTROLLER:
 		return read_classic(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_BALANCE_BOARD])
+	case XWII_IF_BALANCE_BOARD:
 		return read_bboard(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_PRO_CONTROLLER])
+	case XWII_IF_PRO_CONTROLLER:
 		return read_pro(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_DRUMS])
+	case XWII_IF_DRUMS:
 		return read_drums(dev, ev);
-	else if (ep->data.ptr == &dev->ifs[XWII_IF_GUITAR])
+	case XWII_IF_GUITAR:
 		return read_guitar(dev, ev);
+	}
 
 	return -EAGAIN;
 }
 
+/* run swing detection on abs[0] of \ev, scaled by \scale per axis */
+static void derive_swing(struct xwii_iface *dev, struct xwii__swing *s,
+			 const struct xwii_event *ev, const float scale[3],
+			 unsigned int iface)
+{
+	struct xwii_event out[2];
+	float v[3];
+	unsigned int i, n;
+
+	v[0] = ev->v.abs[0].x * scale[0];
+	v[1] = ev->v.abs[0].y * scale[1];
+	v[2] = ev->v.abs[0].z * scale[2];
+
+	n = xwii__swing_update(s, ev, v, iface, out);
+	for (i = 0; i < n; ++i)
+		xwii_iface_push(dev, &out[i]);
+}
+
 /*
- * Poll for events on device \dev.
- *
- * This function always performs any outstanding I/O. If this fails, an error
- * is returned.
- *
- * If @ev is NULL, nothing else is done and 0 is returned.
- *
- * If @ev is non-NULL, this function reads incoming events from the kernel. If
- * no event is available, -EAGAIN is returned. Otherwise, 0 is returned and a
- * single event is stored in @ev. You should call this function in a row until
- * it returns -EAGAIN to get all events.
- *
- * Once this function returns -EAGAIN, you must watch the descriptor returned
- * by xwii_iface_get_fd() for POLLIN/EPOLLIN/read-events. No other events
- * need to be watched for.
- * Once this fd is readable, you should call xwii_iface_poll() again.
- *
- * If an interface gets closed or some hotplug event is detected, this
- * function returns XWII_EVENT_WATCH. This event does not provide any payload
- * and you need to re-open any interfaces if they got closed.
+ * Called for each event read from the kernel before it is returned to the
+ * application. Derived events are queued via xwii_iface_push() and returned
+ * on the following dispatch calls.
  */
-XWII__EXPORT
-int xwii_iface_poll(struct xwii_iface *dev, struct xwii_event *ev)
+static void xwii_iface_derive(struct xwii_iface *dev,
+			      const struct xwii_event *ev)
 {
-	struct epoll_event ep[32];
-	int ret, i;
-	size_t siz;
+	static const float gyro_scale[3] = {
+		1.0f / XWII__FUSION_GYRO_RAD,
+		1.0f / XWII__FUSION_GYRO_RAD,
+		1.0f / XWII__FUSION_GYRO_RAD,
+	};
+	struct xwii_event out;
+
+	if (dev->hub)
+		xwii__hub_store(dev->hub, dev->hub_slot, ev);
+
+	if (dev->frame_enabled && xwii__frame_update(&dev->frame, ev, &out))
+		xwii_iface_push(dev, &out);
+
+	switch (ev->type) {
+	case XWII_EVENT_ACCEL:
+		if (dev->history_accel)
+			xwii__history_push(dev->history_accel, ev, 1);
+		if (dev->fusion.mode)
+			xwii__fusion_accel(&dev->fusion, ev);
+		if (dev->accel.flags & XWII_ACCEL_CALIBRATED) {
+			xwii__accel_update(&dev->accel, ev, &out);
+			xwii_iface_push(dev, &out);
+		}
+		if (dev->swing_accel.start > 0.0f)
+			derive_swing(dev, &dev->swing_accel, ev,
+				     dev->accel.scale, XWII_IFACE_ACCEL);
+		if (dev->gesture &&
+		    xwii__gesture_feed(dev->gesture, XWII__GESTURE_ACCEL, ev,
+				       &ev->v.abs[0], &out))
+			xwii_iface_push(dev, &out);
+		break;
+	case XWII_EVENT_MOTION_PLUS:
+		if (dev->history_mp)
+			xwii__history_push(dev->history_mp, ev, 1);
+		if (xwii__fusion_gyro(&dev->fusion, ev, &out))
+			xwii_iface_push(dev, &out);
+		if (dev->swing_mp.start > 0.0f)
+			derive_swing(dev, &dev->swing_mp, ev, gyro_scale,
+				     XWII_IFACE_MOTION_PLUS);
+		if (dev->gesture &&
+		    xwii__gesture_feed(dev->gesture, XWII__GESTURE_MP, ev,
+				       &ev->v.abs[0], &out))
+			xwii_iface_push(dev, &out);
+		break;
+	case XWII_EVENT_IR:
+		if (dev->history_ir)
+			xwii__history_push(dev->history_ir, ev, 4);
+		if (!dev->pointer_enabled)
+			break;
+		xwii__pointer_update(&dev->pointer, ev,
+				     (dev->ifaces & XWII_IFACE_ACCEL) ?
+						&dev->accel_cache : NULL,
+				     &out);
+		xwii_iface_push(dev, &out);
+		break;
+	case XWII_EVENT_BALANCE_BOARD:
+		if (!dev->bboard_enabled)
+			break;
+		xwii__bboard_update(&dev->bboard, ev, &out);
+		xwii_iface_push(dev, &out);
+		break;
+	}
+}
 
-	if (!dev)
-		return -EFAULT;
+bool xwii__iface_set_hub(struct xwii_iface *dev, struct xwii_hub *hub,
+			 unsigned int slot)
+{
+	if (hub && dev->hub && dev->hub != hub)
+		return false;
 
-	/* write outgoing events here */
+	dev->hub = hub;
+	dev->hub_slot = slot;
+	return true;
+}
 
-	if (!ev)
-		return 0;
+bool xwii__iface_pending(struct xwii_iface *dev)
+{
+	unsigned int tif;
 
-	siz = sizeof(ep) / sizeof(*ep);
-	ret = epoll_wait(dev->efd, ep, siz, 0);
-	if (ret < 0)
-		return -errno;
-	if (ret > siz)
-		ret = siz;
+	if (dev->pending_num)
+		return true;
+	if (dev->frame_enabled && dev->frame.cur.v.frame.ifaces)
+		return true;
 
-	for (i = 0; i < ret; ++i) {
-		ret = dispatch_event(dev, &ep[i], ev);
-		if (ret != -EAGAIN)
-			return ret;
-	}
+	for (tif = 0; tif < XWII_IF_NUM; ++tif)
+		if (dev->ifs[tif].peeked)
+			return true;
 
-	return -EAGAIN;
+	return false;
 }
 
-XWII__EXPORT
-int xwii_iface_dispatch(struct xwii_iface *dev, struct xwii_event *u_ev,
-			size_t size)
-{
+/*
+ * Apply rate limits to \ev after it was derived from; returns true if it is
+ * not to be returned to the application.
+ */
+static bool rate_limit(struct xwii_iface *dev, struct xwii_event *ev)
+{
+	switch (ev->type) {
+	case XWII_EVENT_ACCEL:
+		return dev->accel_rate.period &&
+		       rate_drop(dev, &dev->accel_rate, ev, 1);
+	case XWII_EVENT_BALANCE_BOARD:
+		/* the deadband applies to the averaged values */
+		if (dev->bboard_rate.period &&
+		    rate_drop(dev, &dev->bboard_rate, ev, 4))
+			return true;
+		return deadband_drop(dev, &dev->bboard_deadband, ev->v.abs);
+	default:
+		return false;
+	}
+}
+
+static int dispatch_event(struct xwii_iface *dev, struct epoll_event *ep,
+			  struct xwii_event *ev)
+{
+	unsigned int tif;
+	int ret;
+
+	if (dev->umon && ep->data.ptr == dev->umon)
+		return read_umon(dev, ep, ev);
+	else if (ep->data.ptr == &dev->demand_fd)
+		return read_demand(dev, ep, ev);
+
+	for (tif = 0; tif < XWII_IF_NUM; ++tif) {
+		if (ep->data.ptr != &dev->ifs[tif])
+			continue;
+
+		/*
+		 * Derived events are computed from every report. A report
+		 * dropped by a rate limit is replaced by its derived events,
+		 * if any, or else by the next report.
+		 */
+		while (1) {
+			ret = read_if(dev, tif, ev);
+			if (ret || ev->type == XWII_EVENT_WATCH)
+				return ret;
+
+			xwii_iface_account(dev, tif, ev);
+			if (dev->demand_ifaces & if_to_iface(tif))
+				dev->ifs[tif].demand_until = xwii_now() +
+							     dev->demand_idle;
+			xwii_iface_derive(dev, ev);
+			if (!rate_limit(dev, ev) || xwii_iface_pop(dev, ev))
+				return 0;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+/* interface of ready descriptor \ep or XWII_IF_NUM */
+static unsigned int sched_if(struct xwii_iface *dev,
+			     const struct epoll_event *ep)
+{
+	unsigned int tif;
+
+	for (tif = 0; tif < XWII_IF_NUM; ++tif)
+		if (ep->data.ptr == &dev->ifs[tif])
+			break;
+
+	return tif;
+}
+
+/*
+ * Read ahead the next event of interface \tif; returns its time in µs, 0 if
+ * reading failed and UINT64_MAX if no event is pending. The event is returned
+ * by the next read_event() call.
+ */
+static uint64_t sched_peek(struct xwii_iface *dev, unsigned int tif)
+{
+	struct xwii_if *xif = &dev->ifs[tif];
+	int ret;
+
+	if (!xif->peeked) {
+		ret = read_event(dev, tif, &xif->peek);
+		if (ret == -EAGAIN)
+			return UINT64_MAX;
+		else if (ret)
+			return 0;
+		xif->peeked = 1;
+	}
+
+	return xif->peek.time.tv_sec * 1000000ULL + xif->peek.time.tv_usec;
+}
+
+/*
+ * Dispatch the first event of the \num ready descriptors \ep. Hotplug and
+ * timer descriptors go first, then interfaces by rank. An interface that was
+ * ready but skipped XWII__SCHED_STARVE times in a row is served before all
+ * others, so motion data cannot starve behind a busy key interface. The count
+ * restarts whenever an interface is not ready.
+ *
+ * If frames are enabled, interfaces are served in timestamp order instead, so
+ * the parts of each report are read together even if several reports are
+ * pending. This requires reading one event ahead on each ready interface.
+ */
+static int dispatch_ready(struct xwii_iface *dev, struct epoll_event *ep,
+			  int num, struct xwii_event *ev)
+{
+	unsigned int tif, ready = 0;
+	uint64_t rank[32], r;
+	struct epoll_event tmp;
+	int i, j, ret;
+
+	for (i = 0; i < num; ++i) {
+		tif = sched_if(dev, &ep[i]);
+		if (tif < XWII_IF_NUM)
+			ready |= 1U << tif;
+		if (tif == XWII_IF_NUM)
+			r = 0;
+		else if (dev->frame_enabled)
+			r = sched_peek(dev, tif);
+		else if (dev->sched_skip[tif] >= XWII__SCHED_STARVE)
+			r = 0;
+		else
+			r = dev->sched_rank[tif] + 1;
+
+		/* insertion sort, stable for equal ranks */
+		tmp = ep[i];
+		for (j = i; j > 0 && rank[j - 1] > r; --j) {
+			rank[j] = rank[j - 1];
+			ep[j] = ep[j - 1];
+		}
+		rank[j] = r;
+		ep[j] = tmp;
+	}
+
+	/* skips only count while an interface stays ready */
+	for (tif = 0; tif < XWII_IF_NUM; ++tif)
+		if (!(ready & (1U << tif)))
+			dev->sched_skip[tif] = 0;
+
+	for (i = 0; i < num; ++i) {
+		ret = dispatch_event(dev, &ep[i], ev);
+		if (ret == -EAGAIN)
+			continue;
+
+		tif = sched_if(dev, &ep[i]);
+		if (tif < XWII_IF_NUM)
+			dev->sched_skip[tif] = 0;
+		for (j = i + 1; j < num; ++j) {
+			tif = sched_if(dev, &ep[j]);
+			if (tif < XWII_IF_NUM)
+				++dev->sched_skip[tif];
+		}
+		return ret;
+	}
+
+	/* a read-ahead event may be all that is left of an interface */
+	for (tif = 0; tif < XWII_IF_NUM; ++tif) {
+		if (!dev->ifs[tif].peeked)
+			continue;
+
+		tmp.data.ptr = &dev->ifs[tif];
+		ret = dispatch_event(dev, &tmp, ev);
+		if (ret != -EAGAIN)
+			return ret;
+	}
+
+	return -EAGAIN;
+}
+
+/*
+ * Poll for events on device \dev.
+ *
+ * This function always performs any outstanding I/O. If this fails, an error
+ * is returned.
+ *
+ * If @ev is NULL, nothing else is done and 0 is returned.
+ *
+ * If @ev is non-NULL, this function reads incoming events from the kernel. If
+ * no event is available, -EAGAIN is returned. Otherwise, 0 is returned and a
+ * single event is stored in @ev. You should call this function in a row until
+ * it returns -EAGAIN to get all events.
+ *
+ * Once this function returns -EAGAIN, you must watch the descriptor returned
+ * by xwii_iface_get_fd() for POLLIN/EPOLLIN/read-events. No other events
+ * need to be watched for.
+ * Once this fd is readable, you should call xwii_iface_poll() again.
+ *
+ * If an interface gets closed or some hotplug event is detected, this
+ * function returns XWII_EVENT_WATCH. This event does not provide any payload
+ * and you need to re-open any interfaces if they got closed.
+ */
+XWII__EXPORT
+int xwii_iface_poll(struct xwii_iface *dev, struct xwii_event *ev)
+{
 	struct epoll_event ep[32];
-	int ret, i;
+	int ret;
+	size_t siz;
+
+	if (!dev)
+		return -EFAULT;
+
+	/* write outgoing events here */
+
+	if (!ev)
+		return 0;
+
+	if (xwii_iface_pop(dev, ev))
+		return 0;
+
+	siz = sizeof(ep) / sizeof(*ep);
+	ret = epoll_wait(dev->efd, ep, siz, 0);
+	if (ret < 0)
+		return -errno;
+	if (ret > siz)
+		ret = siz;
+
+	ret = dispatch_ready(dev, ep, ret, ev);
+	if (ret == -EAGAIN && dev->frame_enabled &&
+	    xwii__frame_flush(&dev->frame, ev))
+		return 0;
+
+	return ret;
+}
+
+XWII__EXPORT
+int xwii_iface_dispatch(struct xwii_iface *dev, struct xwii_event *u_ev,
+			size_t size)
+{
+	struct epoll_event ep[32];
+	int ret;
 	size_t siz;
 	struct xwii_event ev;
 
@@ -1756,6 +3343,11 @@ int xwii_iface_dispatch(struct xwii_iface *dev, struct xwii_event *u_ev,
 	if (size > sizeof(ev))
 		size = sizeof(ev);
 
+	if (xwii_iface_pop(dev, &ev)) {
+		memcpy(u_ev, &ev, size);
+		return 0;
+	}
+
 	siz = sizeof(ep) / sizeof(*ep);
 	ret = epoll_wait(dev->efd, ep, siz, 0);
 	if (ret < 0)
@@ -1763,16 +3355,53 @@ int xwii_iface_dispatch(struct xwii_iface *dev, struct xwii_event *u_ev,
 	if (ret > siz)
 		ret = siz;
 
-	for (i = 0; i < ret; ++i) {
-		ret = dispatch_event(dev, &ep[i], &ev);
-		if (ret != -EAGAIN) {
-			if (!ret)
-				memcpy(u_ev, &ev, size);
-			return ret;
+	ret = dispatch_ready(dev, ep, ret, &ev);
+	if (ret == -EAGAIN && dev->frame_enabled &&
+	    xwii__frame_flush(&dev->frame, &ev))
+		ret = 0;
+
+	if (!ret)
+		memcpy(u_ev, &ev, size);
+	return ret;
+}
+
+XWII__EXPORT
+int xwii_iface_dispatch_compact(struct xwii_iface *dev, void *buf,
+				size_t size)
+{
+	struct epoll_event ep[32];
+	struct xwii_compact_event c;
+	struct xwii_event ev;
+	int ret;
+	size_t siz, len;
+
+	if (!dev)
+		return -EFAULT;
+	if (!buf || size < XWII_COMPACT_MAX)
+		return -EINVAL;
+
+	/* skip events without compact encoding */
+	do {
+		if (!xwii_iface_pop(dev, &ev)) {
+			siz = sizeof(ep) / sizeof(*ep);
+			ret = epoll_wait(dev->efd, ep, siz, 0);
+			if (ret < 0)
+				return -errno;
+			if (ret > siz)
+				ret = siz;
+
+			dev->compact = 1;
+			ret = dispatch_ready(dev, ep, ret, &ev);
+			dev->compact = 0;
+			if (ret)
+				return ret;
 		}
-	}
 
-	return -EAGAIN;
+		len = xwii__compact_encode(&ev, &c);
+	} while (!len);
+
+	memcpy(buf, &c, len);
+	return len;
 }
 
 /*
@@ -1874,7 +3503,7 @@ int xwii_iface_get_led(struct xwii_iface *dev, unsigned int led, bool *state)
 		return -EINVAL;
 
 	--led;
-	if (!dev->led_attrs[led])
+	if (xwii_iface_scan(dev) || !dev->led_attrs[led])
 		return -ENODEV;
 
 	return read_led(dev->led_attrs[led], state);
@@ -1887,7 +3516,7 @@ int xwii_iface_set_led(struct xwii_iface *dev, unsigned int led, bool state)
 		return -EINVAL;
 
 	--led;
-	if (!dev->led_attrs[led])
+	if (xwii_iface_scan(dev) || !dev->led_attrs[led])
 		return -ENODEV;
 
 	return write_string(dev->led_attrs[led], state ? "1\n" : "0\n");
@@ -1913,21 +3542,33 @@ int xwii_iface_get_battery(struct xwii_iface *dev, uint8_t *capacity)
 {
 	if (!dev || !capacity)
 		return -EINVAL;
-	if (!dev->battery_attr)
+	if (xwii_iface_scan(dev) || !dev->battery_attr)
 		return -ENODEV;
 
 	return read_battery(dev->battery_attr, capacity);
 }
 
+/* read attribute \attr of the main device */
+static int read_dev_attr(struct xwii_iface *dev, const char *attr, char **out)
+{
+	char path[PATH_MAX];
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s",
+		       xwii_iface_get_syspath(dev), attr);
+	if (ret < 0 || ret >= sizeof(path))
+		return -ENODEV;
+
+	return read_line(path, out);
+}
+
 XWII__EXPORT
 int xwii_iface_get_devtype(struct xwii_iface *dev, char **devtype)
 {
 	if (!dev || !devtype)
 		return -EINVAL;
-	if (!dev->devtype_attr)
-		return -ENODEV;
 
-	return read_line(dev->devtype_attr, devtype);
+	return read_dev_attr(dev, "devtype", devtype);
 }
 
 XWII__EXPORT
@@ -1935,10 +3576,8 @@ int xwii_iface_get_extension(struct xwii_iface *dev, char **extension)
 {
 	if (!dev || !extension)
 		return -EINVAL;
-	if (!dev->extension_attr)
-		return -ENODEV;
 
-	return read_line(dev->extension_attr, extension);
+	return read_dev_attr(dev, "extension", extension);
 }
 
 XWII__EXPORT
@@ -1967,3 +3606,474 @@ void xwii_iface_get_mp_normalization(struct xwii_iface *dev, int32_t *x,
 	if (factor)
 		*factor = dev ? dev->mp_normalize_factor : 0;
 }
+
+XWII__EXPORT
+uint32_t xwii_iface_set_mp_bias_estimation(struct xwii_iface *dev,
+					   uint32_t rate)
+{
+	if (!dev)
+		return 0;
+
+	if (rate > 1024)
+		rate = 1024;
+
+	dev->mp_bias_rate = rate;
+	dev->mp_rest_count = 0;
+	return rate;
+}
+
+XWII__EXPORT
+void xwii_iface_get_mp_bias(struct xwii_iface *dev, int32_t *x, int32_t *y,
+			    int32_t *z)
+{
+	if (x)
+		*x = dev ? mp_bias(dev->mp_bias[0]) : 0;
+	if (y)
+		*y = dev ? mp_bias(dev->mp_bias[1]) : 0;
+	if (z)
+		*z = dev ? mp_bias(dev->mp_bias[2]) : 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_mp_rest_threshold(struct xwii_iface *dev, uint32_t gyro,
+				      uint32_t accel)
+{
+	if (!dev)
+		return;
+
+	dev->mp_rest_gyro = (int64_t)gyro * gyro;
+	dev->mp_rest_accel = (int64_t)accel * accel;
+	dev->mp_rest_count = 0;
+}
+
+XWII__EXPORT
+bool xwii_iface_is_mp_resting(struct xwii_iface *dev)
+{
+	return dev && dev->mp_rest_count >= XWII__MP_REST_SAMPLES;
+}
+
+XWII__EXPORT
+int xwii_iface_set_fusion(struct xwii_iface *dev, unsigned int mode,
+			  float gain)
+{
+	if (!dev)
+		return -EINVAL;
+	if (mode != XWII_FUSION_OFF && mode != XWII_FUSION_FLOAT &&
+	    mode != XWII_FUSION_FIXED)
+		return -EINVAL;
+	if (gain < 0.0f)
+		return -EINVAL;
+
+	if (!gain)
+		gain = XWII__FUSION_GAIN;
+
+	xwii__fusion_init(&dev->fusion, mode, gain);
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_pointer(struct xwii_iface *dev, bool enable)
+{
+	if (!dev)
+		return;
+
+	dev->pointer_enabled = enable;
+	xwii__pointer_init(&dev->pointer);
+}
+
+XWII__EXPORT
+int xwii_iface_set_ir_filter(struct xwii_iface *dev, unsigned int type,
+			     float a, float b, float c)
+{
+	unsigned int i;
+
+	if (!dev)
+		return -EINVAL;
+	if (type != XWII_FILTER_NONE && type != XWII_FILTER_ONE_EURO &&
+	    type != XWII_FILTER_KALMAN)
+		return -EINVAL;
+	if (a < 0 || b < 0 || c < 0)
+		return -EINVAL;
+
+	xwii__filter_setup(&dev->ir_filter, type, a, b, c);
+	for (i = 0; i < 4; ++i) {
+		xwii__filter_reset(&dev->ir_filter_state[i][0]);
+		xwii__filter_reset(&dev->ir_filter_state[i][1]);
+	}
+
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_bboard_weight(struct xwii_iface *dev, bool enable)
+{
+	if (!dev)
+		return;
+
+	dev->bboard_enabled = enable;
+	xwii__bboard_reset(&dev->bboard);
+}
+
+XWII__EXPORT
+int xwii_iface_tare_bboard(struct xwii_iface *dev)
+{
+	if (!dev || !dev->bboard_enabled)
+		return -EINVAL;
+	if (!dev->bboard.time)
+		return -EAGAIN;
+
+	xwii__bboard_tare(&dev->bboard);
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_accel_calibrated(struct xwii_iface *dev,
+				     unsigned int flags)
+{
+	if (!dev)
+		return;
+
+	dev->accel.flags = flags;
+}
+
+XWII__EXPORT
+int xwii_iface_set_accel_calibration(struct xwii_iface *dev,
+				     const struct xwii_event_abs *zero,
+				     const struct xwii_event_abs *one_g)
+{
+	struct xwii_event_abs z = { 0, 0, 0 };
+	struct xwii_event_abs o = {
+		XWII__ACCEL_1G, XWII__ACCEL_1G, XWII__ACCEL_1G
+	};
+
+	if (!dev)
+		return -EINVAL;
+
+	if (zero)
+		z = *zero;
+	if (one_g)
+		o = *one_g;
+
+	if (!xwii__accel_calibrate(&dev->accel, &z, &o))
+		return -EINVAL;
+
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_get_accel_calibration(struct xwii_iface *dev,
+				      struct xwii_event_abs *zero,
+				      struct xwii_event_abs *one_g)
+{
+	if (!dev)
+		return;
+
+	if (zero)
+		*zero = dev->accel.zero;
+	if (one_g)
+		*one_g = dev->accel.one;
+}
+
+XWII__EXPORT
+int xwii_iface_add_gesture(struct xwii_iface *dev, unsigned int id,
+			   unsigned int iface,
+			   const struct xwii_event_abs *samples, size_t num,
+			   float threshold)
+{
+	unsigned int src;
+
+	if (!dev || !samples)
+		return -EINVAL;
+
+	if (iface == XWII_IFACE_ACCEL)
+		src = XWII__GESTURE_ACCEL;
+	else if (iface == XWII_IFACE_MOTION_PLUS)
+		src = XWII__GESTURE_MP;
+	else
+		return -EINVAL;
+
+	if (!dev->gesture) {
+		dev->gesture = xwii__gesture_new();
+		if (!dev->gesture)
+			return -ENOMEM;
+	}
+
+	return xwii__gesture_add(dev->gesture, id, src, samples, num,
+				 threshold);
+}
+
+XWII__EXPORT
+void xwii_iface_remove_gesture(struct xwii_iface *dev, unsigned int id)
+{
+	if (!dev || !dev->gesture)
+		return;
+
+	xwii__gesture_remove(dev->gesture, id);
+}
+
+XWII__EXPORT
+int xwii_iface_set_swing(struct xwii_iface *dev, unsigned int iface,
+			 float start, float impact)
+{
+	if (!dev || start < 0.0f || impact < 0.0f)
+		return -EINVAL;
+
+	if (iface == XWII_IFACE_ACCEL)
+		xwii__swing_init(&dev->swing_accel, start, impact, true);
+	else if (iface == XWII_IFACE_MOTION_PLUS)
+		xwii__swing_init(&dev->swing_mp, start, impact, false);
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_drum_hits(struct xwii_iface *dev, bool enable)
+{
+	if (!dev)
+		return;
+
+	if (enable && !dev->drums_hits)
+		xwii__drums_init(&dev->drums);
+	dev->drums_hits = enable;
+}
+
+XWII__EXPORT
+void xwii_iface_set_guitar_notes(struct xwii_iface *dev, bool enable)
+{
+	if (!dev)
+		return;
+
+	if (enable && !dev->guitar_notes) {
+		dev->guitar_whammy = dev->guitar_cache[1].x;
+		dev->guitar_slider = dev->guitar_cache[2].x;
+	}
+	dev->guitar_notes = enable;
+}
+
+XWII__EXPORT
+int xwii_iface_set_stick(struct xwii_iface *dev, unsigned int iface,
+			 unsigned int mode, float radial, float axial)
+{
+	struct xwii__stick *s;
+	float range;
+
+	if (!dev || mode > XWII_STICK_FLOAT)
+		return -EINVAL;
+	if (radial < 0.0f || radial >= 1.0f || axial < 0.0f || axial >= 1.0f)
+		return -EINVAL;
+
+	if (iface == XWII_IFACE_NUNCHUK) {
+		s = &dev->nunchuk_stick;
+		range = XWII__STICK_NUNCHUK_RANGE;
+	} else if (iface == XWII_IFACE_CLASSIC_CONTROLLER) {
+		s = &dev->classic_stick;
+		range = XWII__STICK_CLASSIC_RANGE;
+	} else if (iface == XWII_IFACE_PRO_CONTROLLER) {
+		s = &dev->pro_stick;
+		range = XWII__STICK_PRO_RANGE;
+	} else {
+		return -EINVAL;
+	}
+
+	xwii__stick_init(s, mode, radial, axial, range);
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_set_deadband(struct xwii_iface *dev, unsigned int iface,
+			    const struct xwii_event_abs *thresholds,
+			    size_t num)
+{
+	struct xwii_deadband *db;
+	size_t max;
+
+	if (!dev || (num && !thresholds))
+		return -EINVAL;
+
+	if (iface == XWII_IFACE_NUNCHUK) {
+		db = &dev->nunchuk_deadband;
+		max = sizeof(dev->nunchuk_cache) / sizeof(*dev->nunchuk_cache);
+	} else if (iface == XWII_IFACE_CLASSIC_CONTROLLER) {
+		db = &dev->classic_deadband;
+		max = sizeof(dev->classic_cache) / sizeof(*dev->classic_cache);
+	} else if (iface == XWII_IFACE_PRO_CONTROLLER) {
+		db = &dev->pro_deadband;
+		max = sizeof(dev->pro_cache) / sizeof(*dev->pro_cache);
+	} else if (iface == XWII_IFACE_BALANCE_BOARD) {
+		db = &dev->bboard_deadband;
+		max = sizeof(dev->bboard_cache) / sizeof(*dev->bboard_cache);
+	} else {
+		return -EINVAL;
+	}
+
+	if (num > max)
+		return -EINVAL;
+
+	memset(db, 0, sizeof(*db));
+	db->num = num;
+	if (num)
+		memcpy(db->thr, thresholds, num * sizeof(*thresholds));
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_set_rate(struct xwii_iface *dev, unsigned int iface,
+			unsigned int mode, unsigned int hz)
+{
+	struct xwii_rate *r;
+
+	if (!dev || mode > XWII_RATE_AVERAGE)
+		return -EINVAL;
+
+	if (iface == XWII_IFACE_ACCEL)
+		r = &dev->accel_rate;
+	else if (iface == XWII_IFACE_BALANCE_BOARD)
+		r = &dev->bboard_rate;
+	else
+		return -EINVAL;
+
+	if (hz > 1000000)
+		return -EINVAL;
+
+	memset(r, 0, sizeof(*r));
+	r->mode = mode;
+	if (hz)
+		r->period = 1000000 / hz;
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_set_priority(struct xwii_iface *dev, const unsigned int *ifaces,
+			    size_t num)
+{
+	unsigned int rank[XWII_IF_NUM];
+	size_t i;
+	int tif;
+
+	if (!dev || (num && !ifaces) || num > XWII_IF_NUM)
+		return -EINVAL;
+
+	/* unlisted interfaces follow in default order */
+	for (i = 0; i < XWII_IF_NUM; ++i)
+		rank[i] = num + if_rank_table[i];
+
+	for (i = 0; i < num; ++i) {
+		if (ifaces[i] > XWII_IFACE_ALL)
+			return -EINVAL;
+		tif = iface_to_if_table[ifaces[i]];
+		if (tif < 0 || rank[tif] < num)
+			return -EINVAL;
+		rank[tif] = i;
+	}
+
+	memcpy(dev->sched_rank, rank, sizeof(rank));
+	memset(dev->sched_skip, 0, sizeof(dev->sched_skip));
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_iface_set_frames(struct xwii_iface *dev, bool enable)
+{
+	if (!dev)
+		return;
+
+	if (enable && !dev->frame_enabled)
+		xwii__frame_init(&dev->frame);
+	dev->frame_enabled = enable;
+}
+
+/* history slot of \iface or NULL */
+static struct xwii__history **history_slot(struct xwii_iface *dev,
+					   unsigned int iface)
+{
+	switch (iface) {
+	case XWII_IFACE_ACCEL:
+		return &dev->history_accel;
+	case XWII_IFACE_IR:
+		return &dev->history_ir;
+	case XWII_IFACE_MOTION_PLUS:
+		return &dev->history_mp;
+	default:
+		return NULL;
+	}
+}
+
+XWII__EXPORT
+int xwii_iface_set_history(struct xwii_iface *dev, unsigned int iface,
+			   size_t size)
+{
+	struct xwii__history **slot, *h = NULL;
+
+	if (!dev || size > XWII_HISTORY_MAX)
+		return -EINVAL;
+
+	slot = history_slot(dev, iface);
+	if (!slot)
+		return -EINVAL;
+
+	if (size) {
+		h = xwii__history_new(size);
+		if (!h)
+			return -ENOMEM;
+	}
+
+	xwii__history_free(*slot);
+	*slot = h;
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_get_history(struct xwii_iface *dev, unsigned int iface,
+			   size_t num, struct xwii_history_span spans[2])
+{
+	struct xwii__history **slot;
+
+	if (!dev || !spans)
+		return -EINVAL;
+
+	slot = history_slot(dev, iface);
+	if (!slot || !*slot)
+		return -EINVAL;
+
+	return xwii__history_get(*slot, num, spans);
+}
+
+XWII__EXPORT
+int xwii_iface_set_recorder(struct xwii_iface *dev, unsigned int seconds)
+{
+	struct xwii__recorder *r = NULL;
+	unsigned int tif;
+
+	if (!dev || seconds > XWII_RECORDER_MAX_SECONDS)
+		return -EINVAL;
+
+	if (seconds) {
+		r = xwii__recorder_new(seconds);
+		if (!r)
+			return -ENOMEM;
+
+		for (tif = 0; tif < XWII_IF_NUM; ++tif) {
+			if (dev->ifs[tif].fd < 0)
+				continue;
+			if (xwii__recorder_add(r, recorder_slot(tif))) {
+				xwii__recorder_free(r);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	xwii__recorder_free(dev->recorder);
+	dev->recorder = r;
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_iface_dump_recorder(struct xwii_iface *dev, int fd)
+{
+	if (!dev || !dev->recorder || fd < 0)
+		return -EINVAL;
+
+	return xwii__recorder_dump(dev->recorder, fd);
+}
@@ -0,0 +1,54 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Drum Hit Detection
+ * A hit is reported for each drum whose pressure rose since the last report,
+ * with the new pressure as velocity and the time of the report. It is
+ * reported on the same report the rise is seen in, so there is no extra frame
+ * of latency for waiting on the peak. A drum is re-armed once its pressure
+ * drops, so a held drum is reported only once. The pad has no pressure and is
+ * never reported.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drums.h"
+#include "xwiimote.h"
+
+void xwii__drums_init(struct xwii__drums *d)
+{
+	memset(d, 0, sizeof(*d));
+	d->armed = ~0U;
+}
+
+unsigned int xwii__drums_update(struct xwii__drums *d,
+				const struct xwii_event *ev,
+				struct xwii_event out[XWII_DRUMS_ABS_NUM])
+{
+	unsigned int i, n = 0;
+	int32_t v;
+
+	for (i = XWII_DRUMS_ABS_CYMBAL_LEFT; i < XWII_DRUMS_ABS_NUM; ++i) {
+		v = ev->v.abs[i].x;
+		if (v > d->last[i] && (d->armed & (1U << i))) {
+			d->armed &= ~(1U << i);
+			memset(&out[n], 0, sizeof(out[n]));
+			out[n].time = ev->time;
+			out[n].type = XWII_EVENT_DRUMS_HIT;
+			out[n].v.drum_hit.drum = i;
+			out[n].v.drum_hit.velocity = v;
+			++n;
+		} else if (v < d->last[i] || v <= 0) {
+			d->armed |= 1U << i;
+		}
+		d->last[i] = v;
+	}
+
+	return n;
+}
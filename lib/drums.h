@@ -0,0 +1,38 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Drum Hit Detection
+ * Turns the pressure values of drums reports into hit events. Nothing in here
+ * allocates memory and nothing in here is part of the public API.
+ */
+
+#ifndef XWII_DRUMS_H
+#define XWII_DRUMS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* hit state; plain data so it can be embedded into xwii_iface */
+struct xwii__drums {
+	/* drums that report a hit once their pressure rises */
+	unsigned int armed;
+	int32_t last[XWII_DRUMS_ABS_NUM];
+};
+
+/* reset \d and arm all drums */
+void xwii__drums_init(struct xwii__drums *d);
+/*
+ * process @ref XWII_EVENT_DRUMS_MOVE event \ev; fills a hit event per drum
+ * that was hit into \out and returns their number
+ */
+unsigned int xwii__drums_update(struct xwii__drums *d,
+				const struct xwii_event *ev,
+				struct xwii_event out[XWII_DRUMS_ABS_NUM]);
+
+#endif /* XWII_DRUMS_H */
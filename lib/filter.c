@@ -0,0 +1,147 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Adaptive Filters
+ * One-Euro: a first-order low-pass whose cutoff frequency grows with the
+ * speed of the signal. Slow movement is smoothed heavily to remove jitter,
+ * fast movement passes with little lag. See Casiez et al., CHI 2012.
+ *
+ * Kalman: a constant-velocity model with position and velocity as state and
+ * white-noise acceleration as process noise. The estimated velocity can be
+ * used to predict the position a short time ahead, which hides the latency
+ * of the filter and of the transport.
+ *
+ * Timesteps are taken from the kernel timestamps of the samples so dropped
+ * reports do not distort the filters.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+#include "xwiimote.h"
+
+/* one-euro defaults */
+#define ONE_EURO_MIN_CUTOFF 1.0f
+#define ONE_EURO_BETA 0.05f
+#define ONE_EURO_D_CUTOFF 1.0f
+/* kalman defaults */
+#define KALMAN_PROCESS 50000.0f
+#define KALMAN_MEASUREMENT 2.0f
+/* initial variance of the kalman velocity estimate */
+#define KALMAN_VELOCITY_VAR 1000000.0f
+
+void xwii__filter_setup(struct xwii__filter_params *params, unsigned int type,
+			float a, float b, float c)
+{
+	params->type = type;
+	params->a = a;
+	params->b = b;
+	params->c = c;
+
+	if (type == XWII_FILTER_ONE_EURO) {
+		if (!params->a)
+			params->a = ONE_EURO_MIN_CUTOFF;
+		if (!params->b)
+			params->b = ONE_EURO_BETA;
+		if (!params->c)
+			params->c = ONE_EURO_D_CUTOFF;
+	} else if (type == XWII_FILTER_KALMAN) {
+		if (!params->a)
+			params->a = KALMAN_PROCESS;
+		if (!params->b)
+			params->b = KALMAN_MEASUREMENT;
+	}
+}
+
+void xwii__filter_reset(struct xwii__filter *f)
+{
+	memset(f, 0, sizeof(*f));
+}
+
+/* smoothing factor of a first-order low-pass with \cutoff Hz */
+static inline float lowpass_alpha(float cutoff, float dt)
+{
+	return 1.0f / (1.0f + 1.0f / (2.0f * (float)M_PI * cutoff * dt));
+}
+
+static float one_euro(struct xwii__filter *f,
+		      const struct xwii__filter_params *params,
+		      float x, float dt)
+{
+	float a, dx;
+
+	dx = (x - f->x) / dt;
+	a = lowpass_alpha(params->c, dt);
+	f->dx += a * (dx - f->dx);
+
+	a = lowpass_alpha(params->a + params->b * fabsf(f->dx), dt);
+	f->x += a * (x - f->x);
+
+	return f->x;
+}
+
+static float kalman(struct xwii__filter *f,
+		    const struct xwii__filter_params *params,
+		    float x, float dt)
+{
+	float q = params->a, r = params->b, *p = f->p, s, k0, k1, y, p1;
+
+	/* predict */
+	f->x += f->dx * dt;
+	p[0] += dt * (2.0f * p[1] + dt * p[2]) + q * dt * dt * dt / 3.0f;
+	p[1] += dt * p[2] + q * dt * dt / 2.0f;
+	p[2] += q * dt;
+
+	/* correct */
+	s = p[0] + r;
+	k0 = p[0] / s;
+	k1 = p[1] / s;
+	y = x - f->x;
+	f->x += k0 * y;
+	f->dx += k1 * y;
+
+	p1 = p[1];
+	p[0] -= k0 * p[0];
+	p[1] -= k0 * p[1];
+	p[2] -= k1 * p1;
+
+	return f->x + f->dx * params->c;
+}
+
+float xwii__filter_update(struct xwii__filter *f,
+			  const struct xwii__filter_params *params,
+			  float x, int64_t time)
+{
+	int64_t dt = time - f->time;
+
+	if (!f->time || dt <= 0 || dt > XWII__FILTER_MAX_DT) {
+		if (f->time && !dt)
+			return f->x;
+
+		f->time = time;
+		f->x = x;
+		f->dx = 0.0f;
+		f->p[0] = params->b;
+		f->p[1] = 0.0f;
+		f->p[2] = KALMAN_VELOCITY_VAR;
+		return x;
+	}
+
+	f->time = time;
+
+	switch (params->type) {
+	case XWII_FILTER_ONE_EURO:
+		return one_euro(f, params, x, dt * 1e-6f);
+	case XWII_FILTER_KALMAN:
+		return kalman(f, params, x, dt * 1e-6f);
+	default:
+		return x;
+	}
+}
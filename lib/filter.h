@@ -0,0 +1,55 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Adaptive Filters
+ * Per-axis smoothing filters for noisy absolute input. Nothing in here
+ * allocates memory and nothing in here is part of the public API.
+ */
+
+#ifndef XWII_FILTER_H
+#define XWII_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* max step in us; longer gaps reset the filter */
+#define XWII__FILTER_MAX_DT 100000
+
+/* filter configuration shared by all axes of an input */
+struct xwii__filter_params {
+	/* enum xwii_filter_type */
+	unsigned int type;
+	/* one-euro: min cutoff in Hz, speed coefficient, derivate cutoff */
+	/* kalman: process noise, measurement noise, prediction in s */
+	float a;
+	float b;
+	float c;
+};
+
+/* state of a single axis */
+struct xwii__filter {
+	/* timestamp of the last sample in us or 0 if reset */
+	int64_t time;
+	/* filtered position and velocity */
+	float x;
+	float dx;
+	/* kalman error covariance */
+	float p[3];
+};
+
+/* set \params to \type with parameters \a, \b and \c, 0 selects defaults */
+void xwii__filter_setup(struct xwii__filter_params *params, unsigned int type,
+			float a, float b, float c);
+/* reset state of a single axis */
+void xwii__filter_reset(struct xwii__filter *f);
+/* feed sample \x taken at \time (in us) into \f and return filtered value */
+float xwii__filter_update(struct xwii__filter *f,
+			  const struct xwii__filter_params *params,
+			  float x, int64_t time);
+
+#endif /* XWII_FILTER_H */
@@ -0,0 +1,181 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Frame Assembler
+ * The kernel reports accelerometer, IR, Motion-Plus and extension data of a
+ * single HID report on separate input devices. Each device stamps its events
+ * itself, so the timestamps of one report may differ by a few microseconds.
+ * Events within XWII__FRAME_WINDOW of the first part are collected into a
+ * frame until an event of a newer report arrives or the device has no more
+ * events to read, whichever comes first. The kernel writes all parts of a
+ * report before the application is woken up and the caller reads interfaces
+ * in timestamp order, so frames are complete without waiting for the next
+ * report, even if several reports are pending. Waiting for a fixed set of
+ * interfaces would not work, as the kernel drops unchanged reports.
+ *
+ * Should a part arrive after its frame was reported anyway, it is left out
+ * instead of starting a second frame with the same timestamp.
+ *
+ * Key state is tracked across frames, as keys are only reported on change.
+ * Core and extension keys are kept apart since they share key codes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame.h"
+#include "xwiimote.h"
+
+void xwii__frame_init(struct xwii__frame *f)
+{
+	memset(f, 0, sizeof(*f));
+}
+
+/* interface of \type, 0 if not part of frames; \num is set to abs values */
+static unsigned int frame_iface(unsigned int type, unsigned int *num)
+{
+	*num = 0;
+
+	switch (type) {
+	case XWII_EVENT_KEY:
+		return XWII_IFACE_CORE;
+	case XWII_EVENT_ACCEL:
+		return XWII_IFACE_ACCEL;
+	case XWII_EVENT_IR:
+		return XWII_IFACE_IR;
+	case XWII_EVENT_MOTION_PLUS:
+		return XWII_IFACE_MOTION_PLUS;
+	case XWII_EVENT_NUNCHUK_MOVE:
+		*num = 2;
+		/* fallthrough */
+	case XWII_EVENT_NUNCHUK_KEY:
+		return XWII_IFACE_NUNCHUK;
+	case XWII_EVENT_CLASSIC_CONTROLLER_MOVE:
+		*num = 3;
+		/* fallthrough */
+	case XWII_EVENT_CLASSIC_CONTROLLER_KEY:
+		return XWII_IFACE_CLASSIC_CONTROLLER;
+	case XWII_EVENT_PRO_CONTROLLER_MOVE:
+		*num = 2;
+		/* fallthrough */
+	case XWII_EVENT_PRO_CONTROLLER_KEY:
+		return XWII_IFACE_PRO_CONTROLLER;
+	case XWII_EVENT_GUITAR_MOVE:
+		*num = 3;
+		/* fallthrough */
+	case XWII_EVENT_GUITAR_KEY:
+		return XWII_IFACE_GUITAR;
+	case XWII_EVENT_BALANCE_BOARD:
+		*num = 4;
+		return XWII_IFACE_BALANCE_BOARD;
+	case XWII_EVENT_DRUMS_KEY:
+		return XWII_IFACE_DRUMS;
+	default:
+		return 0;
+	}
+}
+
+static void frame_start(struct xwii__frame *f, const struct xwii_event *ev,
+			uint64_t time)
+{
+	memset(&f->cur, 0, sizeof(f->cur));
+	f->cur.time = ev->time;
+	f->cur.type = XWII_EVENT_FRAME;
+	f->time = time;
+}
+
+/* track key state of key event \ev of \iface; returns false for other events */
+static bool frame_key(struct xwii__frame *f, unsigned int iface,
+		      const struct xwii_event *ev)
+{
+	uint32_t *keys, bit;
+
+	switch (ev->type) {
+	case XWII_EVENT_KEY:
+	case XWII_EVENT_NUNCHUK_KEY:
+	case XWII_EVENT_CLASSIC_CONTROLLER_KEY:
+	case XWII_EVENT_PRO_CONTROLLER_KEY:
+	case XWII_EVENT_GUITAR_KEY:
+	case XWII_EVENT_DRUMS_KEY:
+		keys = iface == XWII_IFACE_CORE ? &f->keys[0] : &f->keys[1];
+		bit = 1U << ev->v.key.code;
+		if (ev->v.key.state)
+			*keys |= bit;
+		else
+			*keys &= ~bit;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool xwii__frame_update(struct xwii__frame *f, const struct xwii_event *ev,
+			struct xwii_event *out)
+{
+	struct xwii_event_frame *fr = &f->cur.v.frame;
+	unsigned int iface, num, i;
+	uint64_t time;
+	bool done = false, late, key;
+
+	iface = frame_iface(ev->type, &num);
+	if (!iface)
+		return false;
+
+	time = ev->time.tv_sec * 1000000ULL + ev->time.tv_usec;
+	if (fr->ifaces && time > f->time + XWII__FRAME_WINDOW)
+		done = xwii__frame_flush(f, out);
+
+	/* keys are tracked even for parts of frames that were reported */
+	if (fr->ifaces)
+		late = time + XWII__FRAME_WINDOW < f->time;
+	else
+		late = f->last && time <= f->last + XWII__FRAME_WINDOW;
+	key = frame_key(f, iface, ev);
+	if (late)
+		return done;
+
+	if (!fr->ifaces)
+		frame_start(f, ev, time);
+
+	switch (ev->type) {
+	case XWII_EVENT_ACCEL:
+		fr->accel = ev->v.abs[0];
+		break;
+	case XWII_EVENT_MOTION_PLUS:
+		fr->gyro = ev->v.abs[0];
+		break;
+	case XWII_EVENT_IR:
+		for (i = 0; i < 4; ++i) {
+			fr->ir[i][0] = ev->v.abs[i].x;
+			fr->ir[i][1] = ev->v.abs[i].y;
+		}
+		break;
+	default:
+		if (!key)
+			memcpy(fr->ext, ev->v.abs, num * sizeof(*ev->v.abs));
+		break;
+	}
+
+	fr->ifaces |= iface;
+	return done;
+}
+
+bool xwii__frame_flush(struct xwii__frame *f, struct xwii_event *out)
+{
+	struct xwii_event_frame *fr = &f->cur.v.frame;
+
+	if (!fr->ifaces)
+		return false;
+
+	fr->keys = f->keys[0];
+	fr->ext_keys = f->keys[1];
+	memcpy(out, &f->cur, sizeof(*out));
+	fr->ifaces = 0;
+	f->last = f->time;
+	return true;
+}
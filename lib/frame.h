@@ -0,0 +1,48 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Frame Assembler
+ * Merges the events the kernel reports for a single HID report on separate
+ * interfaces into one frame. Nothing in here allocates memory and nothing in
+ * here is part of the public API.
+ */
+
+#ifndef XWII_FRAME_H
+#define XWII_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* max distance in µs between the timestamps of parts of one report */
+#define XWII__FRAME_WINDOW 500
+
+/* frame state; plain data so it can be embedded into xwii_iface */
+struct xwii__frame {
+	/* frame under construction; v.frame.ifaces is 0 while empty */
+	struct xwii_event cur;
+	/* time in µs of the frame under construction and the last reported */
+	uint64_t time;
+	uint64_t last;
+	/* pressed core and extension keys, kept across frames */
+	uint32_t keys[2];
+};
+
+/* reset \f */
+void xwii__frame_init(struct xwii__frame *f);
+/*
+ * add event \ev to the frame; if \ev starts a new report, the previous frame
+ * is complete and stored in \out and true is returned. Parts of reports that
+ * were already reported only update the key state.
+ */
+bool xwii__frame_update(struct xwii__frame *f, const struct xwii_event *ev,
+			struct xwii_event *out);
+/* complete the current frame into \out; returns false if it is empty */
+bool xwii__frame_flush(struct xwii__frame *f, struct xwii_event *out);
+
+#endif /* XWII_FRAME_H */
@@ -0,0 +1,282 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Orientation Fusion
+ * This is a Mahony-style complementary filter without integral term. The
+ * gyroscope rate is integrated into a quaternion and the accelerometer pulls
+ * the estimated gravity vector back towards the measured one, which removes
+ * pitch and roll drift. Yaw cannot be corrected without a magnetometer.
+ *
+ * Both kernels are straight-line code on small fixed-size arrays so the
+ * compiler can keep everything in registers and vectorize where the target
+ * allows it. The fixed-point kernel uses only integer arithmetic for targets
+ * without a fast FPU; its results match the float kernel within rounding.
+ *
+ * The Motion-Plus reports yaw, roll and pitch rates as x, y and z. In the
+ * frame of the accelerometer these are rotations around z, y and x.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fusion.h"
+#include "xwiimote.h"
+
+#define Q30 (1LL << 30)
+
+/* floor(sqrt(\v)) in a constant number of steps */
+static uint32_t isqrt64(uint64_t v)
+{
+	uint64_t r = 0, b = 1ULL << 62;
+	unsigned int i;
+
+	for (i = 0; i < 32; ++i) {
+		if (v >= r + b) {
+			v -= r + b;
+			r = (r >> 1) + b;
+		} else {
+			r >>= 1;
+		}
+		b >>= 2;
+	}
+
+	return r;
+}
+
+/* normalize \v into Q30 quaternion \q; \v must be at most 2 * Q30 long */
+static void normalize_fixed(int32_t q[4], const int64_t v[4])
+{
+	uint64_t n;
+	unsigned int i;
+
+	n = isqrt64(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+	if (!n) {
+		q[0] = Q30;
+		q[1] = q[2] = q[3] = 0;
+		return;
+	}
+
+	for (i = 0; i < 4; ++i)
+		q[i] = (v[i] << 30) / (int64_t)n;
+}
+
+void xwii__fusion_update_float(float q[4], const float g[3], const float a[3],
+			       float kp, float dt)
+{
+	float gx = g[0], gy = g[1], gz = g[2];
+	float qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+	float vx, vy, vz, n;
+
+	n = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+	if (n > 0.0f) {
+		n = kp / sqrtf(n);
+
+		/* gravity as seen from the current estimate */
+		vx = 2.0f * (qx * qz - qw * qy);
+		vy = 2.0f * (qw * qx + qy * qz);
+		vz = qw * qw - qx * qx - qy * qy + qz * qz;
+
+		/* rotate towards the measured gravity */
+		gx += n * (a[1] * vz - a[2] * vy);
+		gy += n * (a[2] * vx - a[0] * vz);
+		gz += n * (a[0] * vy - a[1] * vx);
+	}
+
+	dt *= 0.5f;
+	gx *= dt;
+	gy *= dt;
+	gz *= dt;
+
+	q[0] = qw - qx * gx - qy * gy - qz * gz;
+	q[1] = qx + qw * gx + qy * gz - qz * gy;
+	q[2] = qy + qw * gy - qx * gz + qz * gx;
+	q[3] = qz + qw * gz + qx * gy - qy * gx;
+
+	n = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+			 q[3] * q[3]);
+	q[0] *= n;
+	q[1] *= n;
+	q[2] *= n;
+	q[3] *= n;
+}
+
+void xwii__fusion_update_fixed(int32_t q[4], const int32_t g[3],
+			       const int32_t a[3], int32_t kp, int32_t dt)
+{
+	int64_t gx = g[0], gy = g[1], gz = g[2];
+	int64_t qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+	int64_t ax, ay, az, vx, vy, vz, n, v[4];
+
+	n = (int64_t)a[0] * a[0] + (int64_t)a[1] * a[1] +
+	    (int64_t)a[2] * a[2];
+	if (n > 0) {
+		n = isqrt64(n);
+		ax = ((int64_t)a[0] << 16) / n;
+		ay = ((int64_t)a[1] << 16) / n;
+		az = ((int64_t)a[2] << 16) / n;
+
+		/* gravity as seen from the current estimate, in Q16 */
+		vx = (qx * qz - qw * qy) >> 43;
+		vy = (qw * qx + qy * qz) >> 43;
+		vz = (qw * qw - qx * qx - qy * qy + qz * qz) >> 44;
+
+		/* rotate towards the measured gravity */
+		gx += (kp * ((ay * vz - az * vy) >> 16)) >> 16;
+		gy += (kp * ((az * vx - ax * vz) >> 16)) >> 16;
+		gz += (kp * ((ax * vy - ay * vx) >> 16)) >> 16;
+	}
+
+	/* q' = q + q * (0, g) * dt / 2 with \dt in us */
+	v[0] = qw + ((-qx * gx - qy * gy - qz * gz) >> 16) * dt / 2000000;
+	v[1] = qx + ((qw * gx + qy * gz - qz * gy) >> 16) * dt / 2000000;
+	v[2] = qy + ((qw * gy - qx * gz + qz * gx) >> 16) * dt / 2000000;
+	v[3] = qz + ((qw * gz + qx * gy - qy * gx) >> 16) * dt / 2000000;
+
+	normalize_fixed(q, v);
+}
+
+/*
+ * Reset orientation so the estimated gravity matches \a. This is the shortest
+ * rotation from (0, 0, 1) to \a and avoids a slow start from identity.
+ */
+static void fusion_align(struct xwii__fusion *f, const int32_t a[3])
+{
+	int64_t n, ax, ay, az, v[4];
+	float nf;
+
+	if (f->mode == XWII_FUSION_FIXED) {
+		n = isqrt64((int64_t)a[0] * a[0] + (int64_t)a[1] * a[1] +
+			    (int64_t)a[2] * a[2]);
+		ax = ((int64_t)a[0] << 30) / n;
+		ay = ((int64_t)a[1] << 30) / n;
+		az = ((int64_t)a[2] << 30) / n;
+
+		if (az < -Q30 + (Q30 >> 10)) {
+			v[0] = 0;
+			v[1] = Q30;
+			v[2] = v[3] = 0;
+		} else {
+			v[0] = Q30 + az;
+			v[1] = ay;
+			v[2] = -ax;
+			v[3] = 0;
+		}
+		normalize_fixed(f->qf, v);
+	} else {
+		nf = sqrtf((float)a[0] * a[0] + (float)a[1] * a[1] +
+			   (float)a[2] * a[2]);
+
+		f->q[0] = 1.0f + a[2] / nf;
+		f->q[1] = a[1] / nf;
+		f->q[2] = -a[0] / nf;
+		f->q[3] = 0.0f;
+		if (f->q[0] < 1.0f / 1024) {
+			f->q[0] = 0.0f;
+			f->q[1] = 1.0f;
+			f->q[2] = 0.0f;
+		}
+
+		nf = sqrtf(f->q[0] * f->q[0] + f->q[1] * f->q[1] +
+			   f->q[2] * f->q[2]);
+		f->q[0] /= nf;
+		f->q[1] /= nf;
+		f->q[2] /= nf;
+	}
+}
+
+static int64_t fusion_time(const struct xwii_event *ev)
+{
+	return ev->time.tv_sec * 1000000LL + ev->time.tv_usec;
+}
+
+void xwii__fusion_init(struct xwii__fusion *f, unsigned int mode, float gain)
+{
+	memset(f, 0, sizeof(*f));
+	f->mode = mode;
+	f->q[0] = 1.0f;
+	f->kp = gain;
+	f->qf[0] = Q30;
+	f->kpf = gain * 65536.0f;
+}
+
+void xwii__fusion_accel(struct xwii__fusion *f, const struct xwii_event *ev)
+{
+	f->accel[0] = ev->v.abs[0].x;
+	f->accel[1] = ev->v.abs[0].y;
+	f->accel[2] = ev->v.abs[0].z;
+	f->accel_time = fusion_time(ev);
+}
+
+bool xwii__fusion_gyro(struct xwii__fusion *f, const struct xwii_event *ev,
+		       struct xwii_event *out)
+{
+	struct xwii_event_orientation *o = &out->v.orientation;
+	const struct xwii_event_abs *mp = &ev->v.abs[0];
+	int32_t a[3] = { 0, 0, 0 }, g[3];
+	float af[3], gf[3], vx, vy, vz;
+	int64_t now, dt;
+	bool paired;
+	unsigned int i;
+
+	if (f->mode != XWII_FUSION_FLOAT && f->mode != XWII_FUSION_FIXED)
+		return false;
+
+	now = fusion_time(ev);
+	paired = f->accel_time && llabs(now - f->accel_time) <=
+						XWII__FUSION_PAIR_US;
+	if (paired)
+		memcpy(a, f->accel, sizeof(a));
+	paired = paired && (a[0] || a[1] || a[2]);
+
+	dt = now - f->gyro_time;
+	if (!f->gyro_time || dt > XWII__FUSION_MAX_DT || dt < 0) {
+		if (paired)
+			fusion_align(f, a);
+		dt = 0;
+	}
+	f->gyro_time = now;
+
+	if (dt > 0 && f->mode == XWII_FUSION_FIXED) {
+		g[0] = (int64_t)mp->z * 65536 / XWII__FUSION_GYRO_RAD;
+		g[1] = (int64_t)mp->y * 65536 / XWII__FUSION_GYRO_RAD;
+		g[2] = (int64_t)mp->x * 65536 / XWII__FUSION_GYRO_RAD;
+		xwii__fusion_update_fixed(f->qf, g, a, f->kpf, dt);
+	} else if (dt > 0) {
+		gf[0] = mp->z * (1.0f / XWII__FUSION_GYRO_RAD);
+		gf[1] = mp->y * (1.0f / XWII__FUSION_GYRO_RAD);
+		gf[2] = mp->x * (1.0f / XWII__FUSION_GYRO_RAD);
+		af[0] = a[0];
+		af[1] = a[1];
+		af[2] = a[2];
+		xwii__fusion_update_float(f->q, gf, af, f->kp, dt * 1e-6f);
+	}
+
+	memset(out, 0, sizeof(*out));
+	out->time = ev->time;
+	out->type = XWII_EVENT_ORIENTATION;
+
+	for (i = 0; i < 4; ++i) {
+		if (f->mode == XWII_FUSION_FIXED)
+			o->quat[i] = f->qf[i] * (1.0f / Q30);
+		else
+			o->quat[i] = f->q[i];
+	}
+
+	if (paired) {
+		vx = 2.0f * (o->quat[1] * o->quat[3] - o->quat[0] * o->quat[2]);
+		vy = 2.0f * (o->quat[0] * o->quat[1] + o->quat[2] * o->quat[3]);
+		vz = o->quat[0] * o->quat[0] - o->quat[1] * o->quat[1] -
+		     o->quat[2] * o->quat[2] + o->quat[3] * o->quat[3];
+		o->accel[0] = a[0] * (1.0f / XWII__FUSION_ACCEL_1G) - vx;
+		o->accel[1] = a[1] * (1.0f / XWII__FUSION_ACCEL_1G) - vy;
+		o->accel[2] = a[2] * (1.0f / XWII__FUSION_ACCEL_1G) - vz;
+	}
+
+	return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Orientation Fusion
+ * Combines Motion-Plus gyroscope and accelerometer samples into an orientation
+ * quaternion. There is a float kernel and an integer-only fixed-point kernel
+ * which implement the same filter. Nothing in here allocates memory and
+ * nothing in here is part of the public API.
+ */
+
+#ifndef XWII_FUSION_H
+#define XWII_FUSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* accelerometer units per g */
+#define XWII__FUSION_ACCEL_1G 100
+/* Motion-Plus units per rad/s (roughly 124 units per deg/s) */
+#define XWII__FUSION_GYRO_RAD 7105
+/* max distance of paired accel and gyro samples in us */
+#define XWII__FUSION_PAIR_US 20000
+/* max integration step in us; longer gaps restart the filter */
+#define XWII__FUSION_MAX_DT 100000
+
+/* fusion state; plain data so it can be embedded into struct xwii_iface */
+struct xwii__fusion {
+	/* enum xwii_fusion_mode */
+	unsigned int mode;
+	/* float kernel: quaternion w, x, y, z and proportional gain */
+	float q[4];
+	float kp;
+	/* fixed-point kernel: Q30 quaternion and Q16 gain */
+	int32_t qf[4];
+	int32_t kpf;
+	/* latest accelerometer sample and its timestamp in us */
+	int32_t accel[3];
+	int64_t accel_time;
+	/* timestamp of the previous gyro sample in us or 0 */
+	int64_t gyro_time;
+};
+
+/* float kernel; \g in rad/s, \a in any unit or all 0 to skip correction */
+void xwii__fusion_update_float(float q[4], const float g[3], const float a[3],
+			       float kp, float dt);
+/* fixed-point kernel; \q in Q30, \g in Q16 rad/s, \kp in Q16, \dt in us */
+void xwii__fusion_update_fixed(int32_t q[4], const int32_t g[3],
+			       const int32_t a[3], int32_t kp, int32_t dt);
+
+/* reset \f and select \mode with proportional gain \gain */
+void xwii__fusion_init(struct xwii__fusion *f, unsigned int mode, float gain);
+/* remember accelerometer event \ev for pairing */
+void xwii__fusion_accel(struct xwii__fusion *f, const struct xwii_event *ev);
+/* run filter on Motion-Plus event \ev; returns true if \out was filled */
+bool xwii__fusion_gyro(struct xwii__fusion *f, const struct xwii_event *ev,
+		       struct xwii_event *out);
+
+#endif /* XWII_FUSION_H */
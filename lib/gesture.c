@@ -0,0 +1,217 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Gesture Recognition
+ * Each new sample is appended to a per-device history. The latest samples
+ * are then compared against every template of that source using dynamic time
+ * warping (DTW) restricted to a band around the diagonal, so a gesture may be
+ * performed slightly faster or slower than recorded. The local distance is the
+ * squared euclidean distance of two samples.
+ *
+ * DTW is computed row by row. The local distances of a row do not depend on
+ * each other and are computed with generic vectors, which GCC maps to SSE or
+ * NEON. The accumulation is sequential. As soon as the minimum of a row
+ * exceeds the limit, no path can match anymore and the template is abandoned.
+ * The limit is the tighter of the template threshold and the best match so
+ * far, so most templates are dropped after a few rows.
+ */
+
+#include <errno.h>
+#include <float.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gesture.h"
+#include "xwiimote.h"
+
+typedef float v4sf __attribute__((vector_size(16)));
+
+struct xwii__gesture *xwii__gesture_new(void)
+{
+	return calloc(1, sizeof(struct xwii__gesture));
+}
+
+void xwii__gesture_free(struct xwii__gesture *g)
+{
+	free(g);
+}
+
+int xwii__gesture_add(struct xwii__gesture *g, unsigned int id,
+		      unsigned int src, const struct xwii_event_abs *samples,
+		      size_t num, float threshold)
+{
+	struct xwii__gesture_tmpl *t;
+	size_t i;
+
+	if (src >= XWII__GESTURE_SRC_NUM || num < 2 ||
+	    num > XWII__GESTURE_MAX_LEN || threshold <= 0.0f)
+		return -EINVAL;
+	if (g->num >= XWII__GESTURE_MAX)
+		return -ENOSPC;
+
+	t = &g->tmpl[g->num];
+	memset(t, 0, sizeof(*t));
+	t->id = id;
+	t->src = src;
+	t->len = num;
+	t->limit = threshold * num;
+	for (i = 0; i < num; ++i) {
+		t->t[0][i] = samples[i].x;
+		t->t[1][i] = samples[i].y;
+		t->t[2][i] = samples[i].z;
+	}
+
+	++g->num;
+	return 0;
+}
+
+void xwii__gesture_remove(struct xwii__gesture *g, unsigned int id)
+{
+	unsigned int i = 0;
+
+	while (i < g->num) {
+		if (g->tmpl[i].id == id) {
+			--g->num;
+			memmove(&g->tmpl[i], &g->tmpl[i + 1],
+				(g->num - i) * sizeof(g->tmpl[0]));
+		} else {
+			++i;
+		}
+	}
+}
+
+/* squared distance of query sample \x/\y/\z to template samples \lo to \hi */
+static void local_dist(float *d, const struct xwii__gesture_tmpl *t,
+		       unsigned int lo, unsigned int hi,
+		       float x, float y, float z)
+{
+	v4sf qx = { x, x, x, x }, qy = { y, y, y, y }, qz = { z, z, z, z };
+	v4sf tx, ty, tz, r;
+	unsigned int j;
+
+	for (j = lo; j <= hi; j += 4) {
+		memcpy(&tx, &t->t[0][j], sizeof(tx));
+		memcpy(&ty, &t->t[1][j], sizeof(ty));
+		memcpy(&tz, &t->t[2][j], sizeof(tz));
+		tx -= qx;
+		ty -= qy;
+		tz -= qz;
+		r = tx * tx + ty * ty + tz * tz;
+		memcpy(&d[j - lo], &r, sizeof(r));
+	}
+}
+
+/* banded DTW of \q against \t; returns FLT_MAX once above \limit */
+static float dtw(const struct xwii__gesture_tmpl *t, const float *const q[3],
+		 float limit)
+{
+	float a[XWII__GESTURE_MAX_LEN + 2], b[XWII__GESTURE_MAX_LEN + 2];
+	float d[XWII__GESTURE_MAX_LEN + XWII__GESTURE_PAD];
+	float *prev = a, *cur = b, *tmp, m, v;
+	unsigned int n = t->len, w = n / 8 + 1, i, j, lo, hi;
+
+	/* index j + 1 holds template sample j, index 0 is the border */
+	for (j = 0; j <= n + 1; ++j) {
+		prev[j] = FLT_MAX;
+		cur[j] = FLT_MAX;
+	}
+	prev[0] = 0.0f;
+
+	for (i = 0; i < n; ++i) {
+		lo = i > w ? i - w : 0;
+		hi = i + w < n ? i + w : n - 1;
+		local_dist(d, t, lo, hi, q[0][i], q[1][i], q[2][i]);
+
+		/* cells left and right of the band are unreachable */
+		cur[lo] = FLT_MAX;
+		cur[hi + 2] = FLT_MAX;
+
+		m = FLT_MAX;
+		for (j = lo; j <= hi; ++j) {
+			v = prev[j + 1];
+			if (prev[j] < v)
+				v = prev[j];
+			if (cur[j] < v)
+				v = cur[j];
+			v += d[j - lo];
+			cur[j + 1] = v;
+			if (v < m)
+				m = v;
+		}
+
+		if (m > limit)
+			return FLT_MAX;
+
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+
+	return prev[n] > limit ? FLT_MAX : prev[n];
+}
+
+bool xwii__gesture_feed(struct xwii__gesture *g, unsigned int src,
+			const struct xwii_event *ev,
+			const struct xwii_event_abs *v, struct xwii_event *out)
+{
+	const struct xwii__gesture_tmpl *t, *match = NULL;
+	const float *q[3];
+	float best = FLT_MAX, limit, dist;
+	unsigned int p = g->pos[src], i, a, start;
+
+	g->hist[src][0][p] = g->hist[src][0][p + XWII__GESTURE_RING] = v->x;
+	g->hist[src][1][p] = g->hist[src][1][p + XWII__GESTURE_RING] = v->y;
+	g->hist[src][2][p] = g->hist[src][2][p + XWII__GESTURE_RING] = v->z;
+	g->pos[src] = (p + 1) % XWII__GESTURE_RING;
+	if (g->count[src] < XWII__GESTURE_RING)
+		++g->count[src];
+
+	if (g->hold[src]) {
+		--g->hold[src];
+		return false;
+	}
+
+	for (i = 0; i < g->num; ++i) {
+		t = &g->tmpl[i];
+		if (t->src != src || g->count[src] < t->len)
+			continue;
+
+		start = p + XWII__GESTURE_RING + 1 - t->len;
+		for (a = 0; a < 3; ++a)
+			q[a] = &g->hist[src][a][start];
+
+		limit = t->limit;
+		if (match && best * t->len < limit)
+			limit = best * t->len;
+
+		dist = dtw(t, q, limit);
+		if (dist > limit)
+			continue;
+
+		dist /= t->len;
+		if (dist < best) {
+			best = dist;
+			match = t;
+		}
+	}
+
+	if (!match)
+		return false;
+
+	/* do not report the same movement twice */
+	g->hold[src] = match->len;
+
+	memset(out, 0, sizeof(*out));
+	out->time = ev->time;
+	out->type = XWII_EVENT_GESTURE;
+	out->v.gesture.id = match->id;
+	out->v.gesture.distance = best;
+	out->v.gesture.iface = src == XWII__GESTURE_MP ?
+				XWII_IFACE_MOTION_PLUS : XWII_IFACE_ACCEL;
+	return true;
+}
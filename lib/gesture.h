@@ -0,0 +1,74 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Gesture Recognition
+ * Template matching of accelerometer and Motion-Plus streams. Nothing in
+ * here is part of the public API.
+ */
+
+#ifndef XWII_GESTURE_H
+#define XWII_GESTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* sources */
+enum xwii__gesture_src {
+	XWII__GESTURE_ACCEL,
+	XWII__GESTURE_MP,
+	XWII__GESTURE_SRC_NUM,
+};
+
+/* max template length in samples; must not exceed the history */
+#define XWII__GESTURE_MAX_LEN 64
+/* history length in samples per source */
+#define XWII__GESTURE_RING 128
+/* max number of templates per device */
+#define XWII__GESTURE_MAX 32
+/* padding so vector loops may run past the end of a template */
+#define XWII__GESTURE_PAD 4
+
+struct xwii__gesture_tmpl {
+	unsigned int id;
+	unsigned int src;
+	unsigned int len;
+	/* max accumulated DTW distance for a match */
+	float limit;
+	/* samples as structure-of-arrays */
+	float t[3][XWII__GESTURE_MAX_LEN + XWII__GESTURE_PAD];
+};
+
+struct xwii__gesture {
+	struct xwii__gesture_tmpl tmpl[XWII__GESTURE_MAX];
+	unsigned int num;
+	/*
+	 * history per source and axis; each sample is stored twice, at pos
+	 * and pos + RING, so the latest samples are always contiguous
+	 */
+	float hist[XWII__GESTURE_SRC_NUM][3][2 * XWII__GESTURE_RING];
+	unsigned int pos[XWII__GESTURE_SRC_NUM];
+	unsigned int count[XWII__GESTURE_SRC_NUM];
+	/* samples to skip after a match */
+	unsigned int hold[XWII__GESTURE_SRC_NUM];
+};
+
+struct xwii__gesture *xwii__gesture_new(void);
+void xwii__gesture_free(struct xwii__gesture *g);
+/* add template; returns negative error code on failure */
+int xwii__gesture_add(struct xwii__gesture *g, unsigned int id,
+		      unsigned int src, const struct xwii_event_abs *samples,
+		      size_t num, float threshold);
+/* remove all templates with \id */
+void xwii__gesture_remove(struct xwii__gesture *g, unsigned int id);
+/* feed sample \v of \src; returns true and fills \out on a match */
+bool xwii__gesture_feed(struct xwii__gesture *g, unsigned int src,
+			const struct xwii_event *ev,
+			const struct xwii_event_abs *v, struct xwii_event *out);
+
+#endif /* XWII_GESTURE_H */
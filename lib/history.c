@@ -0,0 +1,90 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Sample History
+ * Each ring holds a power-of-two number of samples, so positions are masked
+ * instead of divided. A sample is exactly one cache line and the ring is
+ * allocated cache-line aligned, so storing a sample touches a single line.
+ * Queries return pointers into the ring: the requested range is contiguous
+ * unless it wraps around the end of the ring, in which case it is returned as
+ * two spans.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+#include "xwiimote.h"
+
+struct xwii__history *xwii__history_new(size_t size)
+{
+	struct xwii__history *h;
+	size_t num = 1;
+	void *p;
+
+	while (num < size)
+		num <<= 1;
+
+	h = calloc(1, sizeof(*h));
+	if (!h)
+		return NULL;
+
+	if (posix_memalign(&p, XWII__HISTORY_ALIGN,
+			   num * sizeof(struct xwii_history_sample))) {
+		free(h);
+		return NULL;
+	}
+
+	memset(p, 0, num * sizeof(struct xwii_history_sample));
+	h->ring = p;
+	h->mask = num - 1;
+	return h;
+}
+
+void xwii__history_free(struct xwii__history *h)
+{
+	if (!h)
+		return;
+
+	free(h->ring);
+	free(h);
+}
+
+void xwii__history_push(struct xwii__history *h, const struct xwii_event *ev,
+			unsigned int num)
+{
+	struct xwii_history_sample *s = &h->ring[h->count & h->mask];
+
+	s->time = ev->time.tv_sec * 1000000ULL + ev->time.tv_usec;
+	memcpy(s->abs, ev->v.abs, num * sizeof(*s->abs));
+	if (num < 4)
+		memset(&s->abs[num], 0, (4 - num) * sizeof(*s->abs));
+	++h->count;
+}
+
+size_t xwii__history_get(const struct xwii__history *h, size_t num,
+			 struct xwii_history_span spans[2])
+{
+	size_t start, first;
+
+	if (num > h->count)
+		num = h->count;
+	if (num > h->mask + 1)
+		num = h->mask + 1;
+
+	start = (h->count - num) & h->mask;
+	first = h->mask + 1 - start;
+	if (first > num)
+		first = num;
+
+	spans[0].samples = &h->ring[start];
+	spans[0].num = first;
+	spans[1].samples = h->ring;
+	spans[1].num = num - first;
+	return num;
+}
@@ -0,0 +1,45 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Sample History
+ * Fixed-size rings of recent samples of a single interface. Nothing in here is
+ * part of the public API.
+ */
+
+#ifndef XWII_HISTORY_H
+#define XWII_HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* ring alignment in bytes; one sample fills one cache line */
+#define XWII__HISTORY_ALIGN 64
+
+struct xwii__history {
+	/* ring of mask + 1 samples */
+	struct xwii_history_sample *ring;
+	size_t mask;
+	/* total number of samples stored */
+	uint64_t count;
+};
+
+/*
+ * allocate ring of at least \size samples, which must not exceed
+ * XWII_HISTORY_MAX; returns NULL if out of memory
+ */
+struct xwii__history *xwii__history_new(size_t size);
+void xwii__history_free(struct xwii__history *h);
+/* store the first \num abs values of \ev */
+void xwii__history_push(struct xwii__history *h, const struct xwii_event *ev,
+			unsigned int num);
+/* return the last up to \num samples as two spans; oldest first */
+size_t xwii__history_get(const struct xwii__history *h, size_t num,
+			 struct xwii_history_span spans[2]);
+
+#endif /* XWII_HISTORY_H */
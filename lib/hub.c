@@ -0,0 +1,476 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Device Hub
+ * A hub collects motion samples of many devices into one structure-of-arrays
+ * store so they can be filtered in a single pass. Each sensor axis is one
+ * channel; a channel is a row of floats with one column per device slot.
+ * Rows are padded to a multiple of 8 floats and 32-byte aligned, so the three
+ * channels of a sensor form one contiguous, aligned block which is processed
+ * by a single call into the vector kernel.
+ *
+ * The kernel computes a first-order low-pass per channel and derives the
+ * high-pass as the difference of input and low-pass. AVX is used if the CPU
+ * supports it, otherwise SSE on x86 and NEON on ARM, with a scalar fallback
+ * for everything else.
+ *
+ * xwii_hub_dispatch() services member devices round-robin. Each device may
+ * return at most a quantum of events before the next device is served, so a
+ * device with a large backlog delays every other device by at most one
+ * quantum per pass. All device descriptors are registered with one epoll
+ * descriptor, so the application has to watch a single fd.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "hub.h"
+#include "xwiimote.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define XWII__HUB_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* row padding in floats and alignment in bytes */
+#define HUB_PAD 8
+#define HUB_ALIGN 32
+/* default low-pass smoothing factor */
+#define HUB_ALPHA 0.2f
+/* default max events per device and round-robin turn */
+#define HUB_QUANTUM 4
+
+typedef void (*hub_kernel)(float *low, float *high, const float *in,
+			   float alpha, size_t num);
+
+struct xwii_hub {
+	size_t ref;
+	/* max number of devices and padded row length */
+	unsigned int size;
+	unsigned int stride;
+	/* device per slot or NULL */
+	struct xwii_iface **devs;
+	/* per slot and sensor; set once a sample was stored */
+	bool *valid;
+	/* low-pass smoothing factor per sensor */
+	float alpha[XWII_HUB_SENSOR_NUM];
+	/* channel rows; channel = sensor * 3 + axis */
+	float *in;
+	float *low;
+	float *high;
+	hub_kernel kernel;
+	/* epoll fd of all device fds, see xwii_hub_get_fd() */
+	int efd;
+	/* round-robin state of xwii_hub_dispatch() */
+	struct epoll_event *ep;
+	bool *ready;
+	unsigned int quantum;
+	unsigned int next;
+	unsigned int burst;
+};
+
+static void filter_scalar(float *low, float *high, const float *in,
+			  float alpha, size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; ++i) {
+		low[i] += alpha * (in[i] - low[i]);
+		high[i] = in[i] - low[i];
+	}
+}
+
+#ifdef XWII__HUB_X86
+
+__attribute__((target("sse")))
+static void filter_sse(float *low, float *high, const float *in,
+		       float alpha, size_t num)
+{
+	__m128 a = _mm_set1_ps(alpha), x, l;
+	size_t i;
+
+	for (i = 0; i < num; i += 4) {
+		x = _mm_load_ps(&in[i]);
+		l = _mm_load_ps(&low[i]);
+		l = _mm_add_ps(l, _mm_mul_ps(a, _mm_sub_ps(x, l)));
+		_mm_store_ps(&low[i], l);
+		_mm_store_ps(&high[i], _mm_sub_ps(x, l));
+	}
+}
+
+__attribute__((target("avx")))
+static void filter_avx(float *low, float *high, const float *in,
+		       float alpha, size_t num)
+{
+	__m256 a = _mm256_set1_ps(alpha), x, l;
+	size_t i;
+
+	for (i = 0; i < num; i += 8) {
+		x = _mm256_load_ps(&in[i]);
+		l = _mm256_load_ps(&low[i]);
+		l = _mm256_add_ps(l, _mm256_mul_ps(a, _mm256_sub_ps(x, l)));
+		_mm256_store_ps(&low[i], l);
+		_mm256_store_ps(&high[i], _mm256_sub_ps(x, l));
+	}
+}
+
+static hub_kernel select_kernel(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx"))
+		return filter_avx;
+	if (__builtin_cpu_supports("sse"))
+		return filter_sse;
+	return filter_scalar;
+}
+
+#elif defined(__ARM_NEON)
+
+static void filter_neon(float *low, float *high, const float *in,
+			float alpha, size_t num)
+{
+	float32x4_t a = vdupq_n_f32(alpha), x, l;
+	size_t i;
+
+	for (i = 0; i < num; i += 4) {
+		x = vld1q_f32(&in[i]);
+		l = vld1q_f32(&low[i]);
+		l = vmlaq_f32(l, a, vsubq_f32(x, l));
+		vst1q_f32(&low[i], l);
+		vst1q_f32(&high[i], vsubq_f32(x, l));
+	}
+}
+
+static hub_kernel select_kernel(void)
+{
+	return filter_neon;
+}
+
+#else
+
+static hub_kernel select_kernel(void)
+{
+	return filter_scalar;
+}
+
+#endif
+
+static float *hub_alloc(size_t num)
+{
+	void *p;
+
+	if (posix_memalign(&p, HUB_ALIGN, num * sizeof(float)))
+		return NULL;
+
+	memset(p, 0, num * sizeof(float));
+	return p;
+}
+
+XWII__EXPORT
+int xwii_hub_new(struct xwii_hub **out, unsigned int size)
+{
+	struct xwii_hub *hub;
+	size_t num;
+	unsigned int i;
+
+	if (!out || !size || size > XWII_HUB_MAX_DEVICES)
+		return -EINVAL;
+
+	hub = calloc(1, sizeof(*hub));
+	if (!hub)
+		return -ENOMEM;
+
+	hub->ref = 1;
+	hub->size = size;
+	hub->stride = (size + HUB_PAD - 1) / HUB_PAD * HUB_PAD;
+	hub->kernel = select_kernel();
+	hub->quantum = HUB_QUANTUM;
+	for (i = 0; i < XWII_HUB_SENSOR_NUM; ++i)
+		hub->alpha[i] = HUB_ALPHA;
+
+	num = (size_t)hub->stride * XWII_HUB_SENSOR_NUM * 3;
+	hub->devs = calloc(size, sizeof(*hub->devs));
+	hub->valid = calloc(size * XWII_HUB_SENSOR_NUM, sizeof(*hub->valid));
+	hub->in = hub_alloc(num);
+	hub->low = hub_alloc(num);
+	hub->high = hub_alloc(num);
+	hub->ep = calloc(size, sizeof(*hub->ep));
+	hub->ready = calloc(size, sizeof(*hub->ready));
+	hub->efd = epoll_create1(EPOLL_CLOEXEC);
+	if (!hub->devs || !hub->valid || !hub->in || !hub->low || !hub->high ||
+	    !hub->ep || !hub->ready || hub->efd < 0) {
+		xwii_hub_unref(hub);
+		return -ENOMEM;
+	}
+
+	*out = hub;
+	return 0;
+}
+
+XWII__EXPORT
+void xwii_hub_ref(struct xwii_hub *hub)
+{
+	if (!hub || !hub->ref)
+		return;
+
+	hub->ref++;
+}
+
+XWII__EXPORT
+void xwii_hub_unref(struct xwii_hub *hub)
+{
+	unsigned int i;
+
+	if (!hub || !hub->ref || --hub->ref)
+		return;
+
+	for (i = 0; hub->devs && i < hub->size; ++i)
+		if (hub->devs[i])
+			xwii_hub_remove(hub, hub->devs[i]);
+
+	if (hub->efd >= 0)
+		close(hub->efd);
+	free(hub->ready);
+	free(hub->ep);
+	free(hub->high);
+	free(hub->low);
+	free(hub->in);
+	free(hub->valid);
+	free(hub->devs);
+	free(hub);
+}
+
+/* reset all channels of \slot */
+static void hub_clear(struct xwii_hub *hub, unsigned int slot)
+{
+	unsigned int c;
+
+	for (c = 0; c < XWII_HUB_SENSOR_NUM * 3; ++c) {
+		hub->in[c * hub->stride + slot] = 0.0f;
+		hub->low[c * hub->stride + slot] = 0.0f;
+		hub->high[c * hub->stride + slot] = 0.0f;
+	}
+
+	for (c = 0; c < XWII_HUB_SENSOR_NUM; ++c)
+		hub->valid[slot * XWII_HUB_SENSOR_NUM + c] = false;
+}
+
+XWII__EXPORT
+int xwii_hub_add(struct xwii_hub *hub, struct xwii_iface *dev)
+{
+	struct epoll_event ep;
+	unsigned int i;
+
+	if (!hub || !dev)
+		return -EINVAL;
+
+	for (i = 0; i < hub->size; ++i)
+		if (hub->devs[i] == dev)
+			return -EALREADY;
+
+	for (i = 0; i < hub->size; ++i)
+		if (!hub->devs[i])
+			break;
+	if (i == hub->size)
+		return -ENOSPC;
+
+	if (!xwii__iface_set_hub(dev, hub, i))
+		return -EBUSY;
+
+	memset(&ep, 0, sizeof(ep));
+	ep.events = EPOLLIN;
+	ep.data.u32 = i;
+	if (epoll_ctl(hub->efd, EPOLL_CTL_ADD, xwii_iface_get_fd(dev), &ep)) {
+		xwii__iface_set_hub(dev, NULL, 0);
+		return -errno;
+	}
+
+	xwii_iface_ref(dev);
+	hub->devs[i] = dev;
+	hub_clear(hub, i);
+	return i;
+}
+
+XWII__EXPORT
+void xwii_hub_remove(struct xwii_hub *hub, struct xwii_iface *dev)
+{
+	unsigned int i;
+
+	if (!hub || !dev)
+		return;
+
+	for (i = 0; i < hub->size; ++i) {
+		if (hub->devs[i] != dev)
+			continue;
+
+		epoll_ctl(hub->efd, EPOLL_CTL_DEL, xwii_iface_get_fd(dev),
+			  NULL);
+		xwii__iface_set_hub(dev, NULL, 0);
+		hub->devs[i] = NULL;
+		hub_clear(hub, i);
+		xwii_iface_unref(dev);
+		return;
+	}
+}
+
+XWII__EXPORT
+int xwii_hub_set_filter(struct xwii_hub *hub, unsigned int sensor,
+			float alpha)
+{
+	if (!hub || sensor >= XWII_HUB_SENSOR_NUM)
+		return -EINVAL;
+	if (alpha <= 0.0f || alpha > 1.0f)
+		return -EINVAL;
+
+	hub->alpha[sensor] = alpha;
+	return 0;
+}
+
+void xwii__hub_store(struct xwii_hub *hub, unsigned int slot,
+		     const struct xwii_event *ev)
+{
+	const struct xwii_event_abs *abs;
+	unsigned int sensor, c;
+	bool *valid;
+
+	switch (ev->type) {
+	case XWII_EVENT_ACCEL:
+		sensor = XWII_HUB_ACCEL;
+		abs = &ev->v.abs[0];
+		break;
+	case XWII_EVENT_MOTION_PLUS:
+		sensor = XWII_HUB_MOTION_PLUS;
+		abs = &ev->v.abs[0];
+		break;
+	case XWII_EVENT_NUNCHUK_MOVE:
+		sensor = XWII_HUB_NUNCHUK;
+		abs = &ev->v.abs[1];
+		break;
+	default:
+		return;
+	}
+
+	c = sensor * 3 * hub->stride + slot;
+	hub->in[c] = abs->x;
+	hub->in[c + hub->stride] = abs->y;
+	hub->in[c + 2 * hub->stride] = abs->z;
+
+	/* start filters at the first sample instead of 0 */
+	valid = &hub->valid[slot * XWII_HUB_SENSOR_NUM + sensor];
+	if (!*valid) {
+		*valid = true;
+		hub->low[c] = abs->x;
+		hub->low[c + hub->stride] = abs->y;
+		hub->low[c + 2 * hub->stride] = abs->z;
+	}
+}
+
+XWII__EXPORT
+void xwii_hub_filter(struct xwii_hub *hub)
+{
+	size_t off, num;
+	unsigned int s;
+
+	if (!hub)
+		return;
+
+	num = (size_t)hub->stride * 3;
+	for (s = 0; s < XWII_HUB_SENSOR_NUM; ++s) {
+		off = s * num;
+		hub->kernel(&hub->low[off], &hub->high[off], &hub->in[off],
+			    hub->alpha[s], num);
+	}
+}
+
+XWII__EXPORT
+int xwii_hub_get(struct xwii_hub *hub, unsigned int slot,
+		 unsigned int sensor, struct xwii_hub_sample *sample)
+{
+	unsigned int a, c;
+
+	if (!hub || !sample || slot >= hub->size ||
+	    sensor >= XWII_HUB_SENSOR_NUM)
+		return -EINVAL;
+	if (!hub->devs[slot] ||
+	    !hub->valid[slot * XWII_HUB_SENSOR_NUM + sensor])
+		return -EAGAIN;
+
+	for (a = 0; a < 3; ++a) {
+		c = (sensor * 3 + a) * hub->stride + slot;
+		sample->raw[a] = hub->in[c];
+		sample->low[a] = hub->low[c];
+		sample->high[a] = hub->high[c];
+	}
+
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_hub_get_fd(struct xwii_hub *hub)
+{
+	if (!hub)
+		return -1;
+
+	return hub->efd;
+}
+
+XWII__EXPORT
+int xwii_hub_set_quantum(struct xwii_hub *hub, unsigned int quantum)
+{
+	if (!hub || !quantum)
+		return -EINVAL;
+
+	hub->quantum = quantum;
+	hub->burst = 0;
+	return 0;
+}
+
+XWII__EXPORT
+int xwii_hub_dispatch(struct xwii_hub *hub, unsigned int *slot,
+		      struct xwii_event *ev, size_t size)
+{
+	struct xwii_iface *dev;
+	unsigned int i, s;
+	int ret, n;
+
+	if (!hub || !slot || !ev || !size)
+		return -EINVAL;
+
+	/* only devices with readable fds or queued derived events are polled */
+	memset(hub->ready, 0, hub->size * sizeof(*hub->ready));
+	n = epoll_wait(hub->efd, hub->ep, hub->size, 0);
+	for (i = 0; n > 0 && i < (unsigned int)n; ++i)
+		if (hub->ep[i].data.u32 < hub->size)
+			hub->ready[hub->ep[i].data.u32] = true;
+
+	for (i = 0; i < hub->size; ++i) {
+		s = hub->next;
+		dev = hub->devs[s];
+		if (dev && (hub->ready[s] || xwii__iface_pending(dev)))
+			ret = xwii_iface_dispatch(dev, ev, size);
+		else
+			ret = -EAGAIN;
+
+		if (ret == -EAGAIN || ++hub->burst >= hub->quantum) {
+			hub->next = (s + 1) % hub->size;
+			hub->burst = 0;
+		}
+
+		if (ret != -EAGAIN) {
+			*slot = s;
+			return ret;
+		}
+	}
+
+	return -EAGAIN;
+}
@@ -0,0 +1,38 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Device Hub
+ * Internal entry points of the hub used by the device code. See hub.c.
+ */
+
+#ifndef XWII_HUB_H
+#define XWII_HUB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* store sample of event \ev of the device in \slot of \hub, if relevant */
+void xwii__hub_store(struct xwii_hub *hub, unsigned int slot,
+		     const struct xwii_event *ev);
+
+/*
+ * set hub membership of \dev, NULL clears it; returns false if \dev already
+ * belongs to another hub. Implemented in core.c.
+ */
+bool xwii__iface_set_hub(struct xwii_iface *dev, struct xwii_hub *hub,
+			 unsigned int slot);
+
+/*
+ * true if \dev has events to return without its fd being readable: queued
+ * derived events, a frame under construction or an event read ahead.
+ * Implemented in core.c.
+ */
+bool xwii__iface_pending(struct xwii_iface *dev);
+
+#endif /* XWII_HUB_H */
@@ -11,16 +11,26 @@
  * Normal applications should integrate this into their own udev-monitor.
  * However, smaller applications might not use udev on their own so this API
  * wraps the udev API in a small easy xwiimote API.
+ * If built without libudev, the driver directory of hid-wiimote in sysfs is
+ * enumerated instead and raw kernel uevents are used for monitoring.
  */
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
+#ifdef HAVE_UDEV
 #include <libudev.h>
+#endif
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "sysfs.h"
 #include "xwiimote.h"
 
+#ifdef HAVE_UDEV
+
 struct xwii_monitor {
 	size_t ref;
 	struct udev *udev;
@@ -223,3 +233,189 @@ char *xwii_monitor_poll(struct xwii_monitor *monitor)
 
 	return NULL;
 }
+
+#else /* HAVE_UDEV */
+
+struct xwii_monitor {
+	size_t ref;
+	DIR *enumerate;
+	struct xwii__umon *monitor;
+};
+
+/*
+ * Without udev, @direct has no effect. We always listen for raw kernel
+ * uevents as there may be no udev daemon to forward them.
+ */
+XWII__EXPORT
+struct xwii_monitor *xwii_monitor_new(bool poll, bool direct)
+{
+	struct xwii_monitor *mon;
+	char dir[PATH_MAX];
+	int r;
+
+	mon = malloc(sizeof(*mon));
+	if (!mon)
+		return NULL;
+	mon->ref = 1;
+	mon->monitor = NULL;
+
+	/* a missing driver directory means no device is bound, yet */
+	r = snprintf(dir, sizeof(dir), "%s%s", xwii__sysfs_root(),
+		     XWII__SYSFS_WIIMOTE_DRIVER);
+	mon->enumerate = r > 0 && r < sizeof(dir) ? opendir(dir) : NULL;
+
+
+	if (poll) {
+		mon->monitor = xwii__umon_new();
+		if (!mon->monitor)
+			goto out;
+	}
+
+	return mon;
+
+out:
+	if (mon->enumerate)
+		closedir(mon->enumerate);
+	free(mon);
+	return NULL;
+}
+
+XWII__EXPORT
+void xwii_monitor_ref(struct xwii_monitor *mon)
+{
+	if (!mon || !mon->ref)
+		return;
+
+	mon->ref++;
+}
+
+static inline void free_enum(struct xwii_monitor *monitor)
+{
+	if (monitor->enumerate) {
+		closedir(monitor->enumerate);
+		monitor->enumerate = NULL;
+	}
+}
+
+XWII__EXPORT
+void xwii_monitor_unref(struct xwii_monitor *monitor)
+{
+	if (!monitor || !monitor->ref)
+		return;
+
+	if (--monitor->ref)
+		return;
+
+	free_enum(monitor);
+	xwii__umon_unref(monitor->monitor);
+	free(monitor);
+}
+
+XWII__EXPORT
+int xwii_monitor_get_fd(struct xwii_monitor *monitor, bool blocking)
+{
+	signed int fd, set;
+
+	if (!monitor || !monitor->monitor)
+		return -1;
+
+	fd = xwii__umon_get_fd(monitor->monitor);
+	if (fd < 0)
+		return -1;
+
+	set = fcntl(fd, F_GETFL);
+	if (set < 0)
+		return -1;
+
+	if (blocking)
+		set &= ~O_NONBLOCK;
+	else
+		set |= O_NONBLOCK;
+
+	if (0 != fcntl(fd, F_SETFL, set))
+		return -1;
+
+	return fd;
+}
+
+/*
+ * The driver directory contains one symlink per bound device, named after
+ * the HID device, next to some control files. Device names always contain a
+ * colon, so we use that to skip the control files.
+ */
+static char *next_enum(struct xwii_monitor *monitor)
+{
+	char path[PATH_MAX];
+	struct dirent *ent;
+	char *ret;
+	int r;
+
+	while ((ent = readdir(monitor->enumerate))) {
+		if (!strchr(ent->d_name, ':'))
+			continue;
+
+		r = snprintf(path, sizeof(path), "%s%s/%s",
+			     xwii__sysfs_root(), XWII__SYSFS_WIIMOTE_DRIVER,
+			     ent->d_name);
+		if (r < 0 || r >= sizeof(path))
+			continue;
+
+		ret = realpath(path, NULL);
+		if (ret)
+			return ret;
+	}
+
+	free_enum(monitor);
+
+	return NULL;
+}
+
+/*
+ * Kernel uevents are sent before udev had a chance to look at the device, so
+ * we cannot rely on the driver being bound during "add". Instead, we wait for
+ * the "bind" event which carries the driver name (linux-4.14 and newer).
+ */
+static char *make_device(const struct xwii__uevent *ev)
+{
+	char *ret;
+
+	if (strcmp(ev->action, "bind"))
+		return NULL;
+	if (!ev->subsystem || strcmp(ev->subsystem, "hid"))
+		return NULL;
+	if (!ev->driver || strcmp(ev->driver, "wiimote"))
+		return NULL;
+
+	if (asprintf(&ret, "%s%s", xwii__sysfs_root(), ev->devpath) <= 0)
+		return NULL;
+
+	return ret;
+}
+
+XWII__EXPORT
+char *xwii_monitor_poll(struct xwii_monitor *monitor)
+{
+	struct xwii__uevent ev;
+	char *ret;
+
+	if (!monitor)
+		return NULL;
+
+	if (monitor->enumerate) {
+		/* returns NULL to notify application of end of enum */
+		return next_enum(monitor);
+	} else if (monitor->monitor) {
+		while (1) {
+			if (xwii__umon_receive(monitor->monitor, &ev))
+				return NULL;
+
+			ret = make_device(&ev);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return NULL;
+}
+
+#endif /* HAVE_UDEV */
@@ -0,0 +1,180 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * IR Pointer
+ * Dots are converted into view coordinates first: the origin is the center of
+ * the camera and x is mirrored, so moving the pointer right increases x.
+ *
+ * Each frame, all six pairs of the four IR slots are scored. If two dots were
+ * tracked in the previous frame, the pair closest to them is preferred so the
+ * same light sources are followed even if other reflections show up. If
+ * tracking is lost, the pair which is most horizontal after roll compensation
+ * and widest apart is picked. The accelerometer, if available, provides the
+ * roll estimate used for that and resolves which dot is left and right.
+ * If only one of the tracked dots is left, the other one is extrapolated from
+ * the last known bar vector. The loop bounds are fixed, so every frame costs
+ * the same.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pointer.h"
+#include "xwiimote.h"
+
+/* all pairs of the 4 IR slots */
+static const unsigned int pairs[6][2] = {
+	{ 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 },
+};
+
+void xwii__pointer_init(struct xwii__pointer *p)
+{
+	memset(p, 0, sizeof(*p));
+}
+
+/* squared distance of view point \u/\v to \dot */
+static inline float dist2(float u, float v, const float dot[2])
+{
+	return (u - dot[0]) * (u - dot[0]) + (v - dot[1]) * (v - dot[1]);
+}
+
+void xwii__pointer_update(struct xwii__pointer *p, const struct xwii_event *ev,
+			  const struct xwii_event_abs *accel,
+			  struct xwii_event *out)
+{
+	struct xwii_event_pointer *o = &out->v.pointer;
+	float u[4], v[4], hx, hy, du, dv, ortho, sep, cost, swapped, lr[2][2];
+	float track_best, acq_best = FLT_MAX, one_best, roll, c, s, mx, my;
+	unsigned int i, k, a, b, track = 6, acq = 6, one = 4, side = 0;
+	bool ok[4], track_swap = false, acq_swap = false, swap;
+
+	for (i = 0; i < 4; ++i) {
+		ok[i] = xwii_event_ir_is_valid(&ev->v.abs[i]);
+		u[i] = XWII__IR_WIDTH / 2 - ev->v.abs[i].x;
+		v[i] = ev->v.abs[i].y - XWII__IR_HEIGHT / 2;
+	}
+
+	/* horizontal direction of the bar we expect to see */
+	roll = p->roll;
+	if (accel && (accel->x || accel->z))
+		roll = atan2f(accel->x, accel->z);
+	hx = cosf(roll);
+	hy = sinf(roll);
+
+	/* only accept tracked pairs that moved less than the limit */
+	track_best = 2 * XWII__IR_TRACK_DIST * XWII__IR_TRACK_DIST;
+
+	for (k = 0; k < 6; ++k) {
+		a = pairs[k][0];
+		b = pairs[k][1];
+		if (!ok[a] || !ok[b])
+			continue;
+
+		/* acquisition: horizontal and wide apart */
+		du = u[b] - u[a];
+		dv = v[b] - v[a];
+		ortho = dv * hx - du * hy;
+		sep = du * du + dv * dv;
+		cost = (ortho * ortho + 1.0f) / (sep + 1.0f);
+		if (cost < acq_best) {
+			acq_best = cost;
+			acq = k;
+			acq_swap = du * hx + dv * hy < 0;
+		}
+
+		/* tracking: close to the dots of the previous frame */
+		if (p->tracked) {
+			cost = dist2(u[a], v[a], p->dot[0]) +
+			       dist2(u[b], v[b], p->dot[1]);
+			swapped = dist2(u[b], v[b], p->dot[0]) +
+				  dist2(u[a], v[a], p->dot[1]);
+			swap = swapped < cost;
+			if (swap)
+				cost = swapped;
+			if (cost < track_best) {
+				track_best = cost;
+				track = k;
+				track_swap = swap;
+			}
+		}
+	}
+
+	/* if only one of the tracked dots is left, follow it */
+	one_best = XWII__IR_TRACK_DIST * XWII__IR_TRACK_DIST;
+	for (i = 0; i < 4; ++i) {
+		for (k = 0; k < 2; ++k) {
+			cost = dist2(u[i], v[i], p->dot[k]);
+			if (p->tracked && ok[i] && cost < one_best) {
+				one_best = cost;
+				one = i;
+				side = k;
+			}
+		}
+	}
+
+	if (track == 6 && one == 4) {
+		track = acq;
+		track_swap = acq_swap;
+	}
+
+	if (track < 6) {
+		a = pairs[track][track_swap];
+		b = pairs[track][!track_swap];
+		lr[0][0] = u[a];
+		lr[0][1] = v[a];
+		lr[1][0] = u[b];
+		lr[1][1] = v[b];
+		p->tracked = 2;
+	} else if (one < 4) {
+		du = p->dot[1][0] - p->dot[0][0];
+		dv = p->dot[1][1] - p->dot[0][1];
+		lr[side][0] = u[one];
+		lr[side][1] = v[one];
+		lr[!side][0] = u[one] + (side ? -du : du);
+		lr[!side][1] = v[one] + (side ? -dv : dv);
+		p->tracked = 1;
+	} else {
+		p->tracked = 0;
+	}
+
+	memset(out, 0, sizeof(*out));
+	out->time = ev->time;
+	out->type = XWII_EVENT_POINTER;
+
+	if (!p->tracked) {
+		o->x = p->x;
+		o->y = p->y;
+		o->roll = p->roll;
+		return;
+	}
+
+	memcpy(p->dot, lr, sizeof(lr));
+	du = lr[1][0] - lr[0][0];
+	dv = lr[1][1] - lr[0][1];
+	if (p->tracked == 2 || !accel)
+		p->roll = atan2f(dv, du);
+	else
+		p->roll = roll;
+
+	/* undo roll around the camera center */
+	c = cosf(p->roll);
+	s = sinf(p->roll);
+	mx = (lr[0][0] + lr[1][0]) / 2;
+	my = (lr[0][1] + lr[1][1]) / 2;
+	p->x = (mx * c + my * s) / (XWII__IR_WIDTH / 2);
+	p->y = (my * c - mx * s) / (XWII__IR_HEIGHT / 2);
+
+	sep = sqrtf(du * du + dv * dv);
+	o->x = p->x;
+	o->y = p->y;
+	o->roll = p->roll;
+	o->distance = sep > 0 ? XWII__IR_BAR_WIDTH * XWII__IR_FOCAL / sep : 0;
+	o->dots = p->tracked;
+}
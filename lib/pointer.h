@@ -0,0 +1,52 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * IR Pointer
+ * Turns raw IR camera dots into a cursor position, distance and roll by
+ * tracking the two light sources of a sensor bar. Nothing in here allocates
+ * memory and nothing in here is part of the public API.
+ */
+
+#ifndef XWII_POINTER_H
+#define XWII_POINTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* IR camera resolution */
+#define XWII__IR_WIDTH 1024
+#define XWII__IR_HEIGHT 768
+/* IR camera focal length in pixels (about 33 degrees horizontal FOV) */
+#define XWII__IR_FOCAL 1728.0f
+/* distance between both light sources of a sensor bar in meters */
+#define XWII__IR_BAR_WIDTH 0.205f
+/* max movement of a tracked dot between two frames in pixels */
+#define XWII__IR_TRACK_DIST 96.0f
+
+/* pointer state; plain data so it can be embedded into struct xwii_iface */
+struct xwii__pointer {
+	/* tracked left/right dots in view coordinates */
+	float dot[2][2];
+	/* number of dots in the previous frame; both are valid if non-zero */
+	unsigned int tracked;
+	/* roll of the previous frame in radians */
+	float roll;
+	/* last reported cursor position */
+	float x;
+	float y;
+};
+
+/* reset \p */
+void xwii__pointer_init(struct xwii__pointer *p);
+/* solve IR event \ev with optional accelerometer sample \accel into \out */
+void xwii__pointer_update(struct xwii__pointer *p, const struct xwii_event *ev,
+			  const struct xwii_event_abs *accel,
+			  struct xwii_event *out);
+
+#endif /* XWII_POINTER_H */
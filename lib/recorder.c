@@ -0,0 +1,204 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Flight Recorder
+ * Each interface gets a power-of-two ring of raw input events, sized for the
+ * recorded time span at XWII__RECORDER_RATE events per second. Recording is a
+ * single copy into the ring. The time span is only applied when dumping: the
+ * rings of all interfaces are merged by timestamp and events older than the
+ * span, relative to the newest event, are left out.
+ *
+ * Dumping must be usable from signal handlers, so it neither allocates memory
+ * nor uses stdio. Records are collected in a small buffer on the stack and
+ * written with write(). If a signal interrupts recording, the event being
+ * recorded may be dumped incomplete.
+ */
+
+#include <errno.h>
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "recorder.h"
+#include "xwiimote.h"
+
+/* records buffered on the stack while dumping */
+#define RECORDER_BUF 64
+
+struct xwii__recorder *xwii__recorder_new(unsigned int seconds)
+{
+	struct xwii__recorder *r;
+	size_t num = 1;
+
+	if (!seconds)
+		return NULL;
+
+	while (num < (size_t)seconds * XWII__RECORDER_RATE)
+		num <<= 1;
+
+	r = calloc(1, sizeof(*r));
+	if (!r)
+		return NULL;
+
+	r->seconds = seconds;
+	r->mask = num - 1;
+	return r;
+}
+
+void xwii__recorder_free(struct xwii__recorder *r)
+{
+	unsigned int i;
+
+	if (!r)
+		return;
+
+	for (i = 0; i < XWII__RECORDER_SLOTS; ++i)
+		free(r->rings[i]);
+	free(r);
+}
+
+int xwii__recorder_add(struct xwii__recorder *r, unsigned int slot)
+{
+	struct xwii__recorder_ring *ring;
+
+	if (r->rings[slot])
+		return 0;
+
+	ring = calloc(1, sizeof(*ring) + (r->mask + 1) * sizeof(*ring->ev));
+	if (!ring)
+		return -ENOMEM;
+
+	r->rings[slot] = ring;
+	return 0;
+}
+
+void xwii__recorder_push(struct xwii__recorder *r, unsigned int slot,
+			 const struct input_event *ev)
+{
+	struct xwii__recorder_ring *ring = r->rings[slot];
+
+	if (!ring)
+		return;
+
+	ring->ev[ring->count & r->mask] = *ev;
+	++ring->count;
+}
+
+static uint64_t recorder_time(const struct input_event *ev)
+{
+	return ev->time.tv_sec * 1000000ULL + ev->time.tv_usec;
+}
+
+static int recorder_write(int fd, const void *data, size_t size)
+{
+	const char *p = data;
+	ssize_t l;
+
+	while (size) {
+		l = write(fd, p, size);
+		if (l < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += l;
+		size -= l;
+	}
+
+	return 0;
+}
+
+int xwii__recorder_dump(const struct xwii__recorder *r, int fd)
+{
+	const struct xwii__recorder_ring *ring;
+	struct xwii_recorder_header hdr;
+	struct xwii_recorder_record buf[RECORDER_BUF];
+	const struct input_event *ev;
+	uint64_t pos[XWII__RECORDER_SLOTS], end[XWII__RECORDER_SLOTS];
+	uint64_t t, cur = 0, newest = 0, oldest = UINT64_MAX, limit = 0;
+	unsigned int i, slot, n = 0;
+	uint32_t total = 0;
+	int ret, errsv = errno;
+
+	/* snapshot the valid range of each ring and find the newest event */
+	for (i = 0; i < XWII__RECORDER_SLOTS; ++i) {
+		ring = r->rings[i];
+		pos[i] = end[i] = ring ? ring->count : 0;
+		if (!end[i])
+			continue;
+
+		pos[i] = end[i] > r->mask + 1 ? end[i] - r->mask - 1 : 0;
+		t = recorder_time(&ring->ev[(end[i] - 1) & r->mask]);
+		if (t > newest)
+			newest = t;
+	}
+
+	/* drop events older than the recorded time span */
+	if (newest > r->seconds * 1000000ULL)
+		limit = newest - r->seconds * 1000000ULL;
+	for (i = 0; i < XWII__RECORDER_SLOTS; ++i) {
+		ring = r->rings[i];
+		while (pos[i] < end[i] &&
+		       recorder_time(&ring->ev[pos[i] & r->mask]) < limit)
+			++pos[i];
+		if (pos[i] == end[i])
+			continue;
+
+		t = recorder_time(&ring->ev[pos[i] & r->mask]);
+		if (t < oldest)
+			oldest = t;
+		total += end[i] - pos[i];
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, XWII_RECORDER_MAGIC, sizeof(hdr.magic));
+	hdr.time = total ? oldest : 0;
+	hdr.num = total;
+	hdr.seconds = r->seconds;
+	ret = recorder_write(fd, &hdr, sizeof(hdr));
+	if (ret)
+		goto out;
+
+	/* merge all rings by timestamp */
+	while (1) {
+		slot = XWII__RECORDER_SLOTS;
+		for (i = 0; i < XWII__RECORDER_SLOTS; ++i) {
+			if (pos[i] == end[i])
+				continue;
+			t = recorder_time(&r->rings[i]->ev[pos[i] & r->mask]);
+			if (slot == XWII__RECORDER_SLOTS || t < cur) {
+				slot = i;
+				cur = t;
+			}
+		}
+
+		if (n == RECORDER_BUF ||
+		    (n && slot == XWII__RECORDER_SLOTS)) {
+			ret = recorder_write(fd, buf, n * sizeof(*buf));
+			if (ret)
+				goto out;
+			n = 0;
+		}
+		if (slot == XWII__RECORDER_SLOTS)
+			break;
+
+		ev = &r->rings[slot]->ev[pos[slot]++ & r->mask];
+		buf[n].time = cur - hdr.time;
+		buf[n].iface = slot;
+		buf[n].type = ev->type;
+		buf[n].code = ev->code;
+		buf[n].value = ev->value;
+		++n;
+	}
+
+	ret = total;
+out:
+	errno = errsv;
+	return ret;
+}
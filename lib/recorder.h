@@ -0,0 +1,56 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Flight Recorder
+ * Keeps the raw input events of the last seconds per interface and dumps them
+ * in the format described in xwiimote.h. Nothing in here is part of the
+ * public API.
+ */
+
+#ifndef XWII_RECORDER_H
+#define XWII_RECORDER_H
+
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* one slot per bit of the public interface mask */
+#define XWII__RECORDER_SLOTS 16
+/* input events per second a ring is sized for */
+#define XWII__RECORDER_RATE 2048
+
+struct xwii__recorder_ring {
+	/* total number of events stored */
+	uint64_t count;
+	struct input_event ev[];
+};
+
+struct xwii__recorder {
+	unsigned int seconds;
+	/* events per ring minus 1 */
+	size_t mask;
+	/* rings, allocated via xwii__recorder_add() */
+	struct xwii__recorder_ring *rings[XWII__RECORDER_SLOTS];
+};
+
+/*
+ * allocate recorder for the last \seconds, which must not exceed
+ * XWII_RECORDER_MAX_SECONDS; returns NULL if out of memory
+ */
+struct xwii__recorder *xwii__recorder_new(unsigned int seconds);
+void xwii__recorder_free(struct xwii__recorder *r);
+/* allocate the ring of slot \slot unless done before */
+int xwii__recorder_add(struct xwii__recorder *r, unsigned int slot);
+/* record \ev read from the interface of slot \slot; no-op without a ring */
+void xwii__recorder_push(struct xwii__recorder *r, unsigned int slot,
+			 const struct input_event *ev);
+/* write recorded events to \fd; async-signal-safe */
+int xwii__recorder_dump(const struct xwii__recorder *r, int fd);
+
+#endif /* XWII_RECORDER_H */
@@ -0,0 +1,104 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Analog Sticks
+ * The first sample of a stick is taken as its center, as sticks rest when
+ * devices are connected. Afterwards, the center follows slowly while the stick
+ * rests close to it, which compensates drift. The range is learned per axis
+ * and direction: it starts at a conservative default and grows whenever the
+ * stick is deflected further, so worn sticks still reach full deflection.
+ *
+ * Normalized positions get the axial deadzone applied first, then the radial
+ * one. Both rescale the remaining range so the output is continuous and still
+ * reaches 1 at full deflection.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stick.h"
+#include "xwiimote.h"
+
+void xwii__stick_init(struct xwii__stick *s, unsigned int mode, float radial,
+		      float axial, float range)
+{
+	memset(s, 0, sizeof(*s));
+	s->mode = mode;
+	s->radial = radial;
+	s->axial = axial;
+	s->range = range;
+}
+
+/* scale \v from \dz..1 to 0..1, keeping the sign */
+static float deadzone(float v, float dz)
+{
+	float a = fabsf(v);
+
+	if (a <= dz)
+		return 0.0f;
+
+	a = (a - dz) / (1.0f - dz);
+	return v < 0.0f ? -a : a;
+}
+
+void xwii__stick_update(struct xwii__stick *s, unsigned int i,
+			const struct xwii_event_abs *raw, float out[2])
+{
+	float v[2], d, m;
+	unsigned int a;
+
+	if (!s->init[i]) {
+		s->init[i] = true;
+		s->center[i][0] = raw->x;
+		s->center[i][1] = raw->y;
+		for (a = 0; a < 2; ++a) {
+			s->lo[i][a] = -s->range;
+			s->hi[i][a] = s->range;
+		}
+	}
+
+	for (a = 0; a < 2; ++a) {
+		d = (a ? raw->y : raw->x) - s->center[i][a];
+		if (d > s->hi[i][a])
+			s->hi[i][a] = d;
+		else if (d < s->lo[i][a])
+			s->lo[i][a] = d;
+		v[a] = d >= 0.0f ? d / s->hi[i][a] : -d / s->lo[i][a];
+	}
+
+	/* follow the center while resting */
+	if (fabsf(v[0]) < XWII__STICK_REST && fabsf(v[1]) < XWII__STICK_REST) {
+		s->center[i][0] += XWII__STICK_TRACK *
+				   (raw->x - s->center[i][0]);
+		s->center[i][1] += XWII__STICK_TRACK *
+				   (raw->y - s->center[i][1]);
+	}
+
+	if (s->axial > 0.0f) {
+		v[0] = deadzone(v[0], s->axial);
+		v[1] = deadzone(v[1], s->axial);
+	}
+
+	m = sqrtf(v[0] * v[0] + v[1] * v[1]);
+	if (s->radial > 0.0f && m > 0.0f) {
+		d = deadzone(m, s->radial) / m;
+		v[0] *= d;
+		v[1] *= d;
+		m *= d;
+	}
+
+	/* diagonals may exceed the unit circle */
+	if (m > 1.0f) {
+		v[0] /= m;
+		v[1] /= m;
+	}
+
+	out[0] = v[0];
+	out[1] = v[1];
+}
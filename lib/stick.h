@@ -0,0 +1,56 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Analog Sticks
+ * Self-calibrating center, range and deadzone processing of the analog sticks
+ * of nunchuk, classic and pro controllers. Nothing in here allocates memory
+ * and nothing in here is part of the public API.
+ */
+
+#ifndef XWII_STICK_H
+#define XWII_STICK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* max number of sticks per interface */
+#define XWII__STICK_NUM 2
+/* raw half range assumed before any deflection was seen */
+#define XWII__STICK_NUNCHUK_RANGE 70.0f
+#define XWII__STICK_CLASSIC_RANGE 20.0f
+#define XWII__STICK_PRO_RANGE 800.0f
+/* the center is tracked while the stick rests within this radius */
+#define XWII__STICK_REST 0.1f
+/* center tracking smoothing factor per sample */
+#define XWII__STICK_TRACK 0.01f
+
+/* stick state of one interface; plain data so it can be embedded */
+struct xwii__stick {
+	/* enum xwii_stick_mode */
+	unsigned int mode;
+	/* deadzones as fraction of the range */
+	float radial;
+	float axial;
+	/* initial half range in raw units */
+	float range;
+	/* per stick: learned center and extremes relative to it, per axis */
+	bool init[XWII__STICK_NUM];
+	float center[XWII__STICK_NUM][2];
+	float lo[XWII__STICK_NUM][2];
+	float hi[XWII__STICK_NUM][2];
+};
+
+/* reset \s; \range is the initial half range in raw units */
+void xwii__stick_init(struct xwii__stick *s, unsigned int mode, float radial,
+		      float axial, float range);
+/* process raw position \raw of stick \i into \out, normalized to -1..1 */
+void xwii__stick_update(struct xwii__stick *s, unsigned int i,
+			const struct xwii_event_abs *raw, float out[2]);
+
+#endif /* XWII_STICK_H */
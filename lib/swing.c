@@ -0,0 +1,127 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Swing Detection
+ * A swing starts when the magnitude of the motion crosses the start
+ * threshold. For accelerometer data, gravity is removed first by a slow
+ * low-pass which is frozen during a swing. The highest magnitude is tracked
+ * and reported as peak as soon as the magnitude drops noticeably below it,
+ * usually one sample after the actual peak, instead of waiting for the swing
+ * to end. If the magnitude rises again, another peak is reported for the same
+ * swing. An impact is a large change between two consecutive samples and is
+ * reported at most once per swing. The swing ends after a couple of quiet
+ * samples. As the remote may end a swing in another orientation, the frozen
+ * gravity estimate would leave a residual magnitude behind. So a held still
+ * remote, whose samples barely change and have the magnitude of gravity,
+ * counts as quiet, too, and gravity is re-seeded from the sample that ends
+ * the swing.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swing.h"
+#include "xwiimote.h"
+
+void xwii__swing_init(struct xwii__swing *s, float start, float impact,
+		      bool gravity)
+{
+	memset(s, 0, sizeof(*s));
+	s->start = start;
+	s->impact = impact;
+	s->gravity = gravity;
+}
+
+static void swing_event(struct xwii_event *out, const struct timeval *time,
+			unsigned int phase, unsigned int iface, float strength)
+{
+	memset(out, 0, sizeof(*out));
+	out->time = *time;
+	out->type = XWII_EVENT_SWING;
+	out->v.swing.phase = phase;
+	out->v.swing.iface = iface;
+	out->v.swing.strength = strength;
+}
+
+unsigned int xwii__swing_update(struct xwii__swing *s,
+				const struct xwii_event *ev, const float v[3],
+				unsigned int iface, struct xwii_event out[2])
+{
+	float d[3], m, j = 0.0f, g = 0.0f, r = 0.0f, still;
+	unsigned int i, n = 0;
+	bool quiet;
+
+	if (!s->init) {
+		s->init = true;
+		memcpy(s->low, v, sizeof(s->low));
+		memcpy(s->prev, v, sizeof(s->prev));
+	}
+
+	for (i = 0; i < 3; ++i) {
+		d[i] = s->gravity ? v[i] - s->low[i] : v[i];
+		j += (v[i] - s->prev[i]) * (v[i] - s->prev[i]);
+		g += s->low[i] * s->low[i];
+		r += v[i] * v[i];
+		s->prev[i] = v[i];
+	}
+	m = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	j = sqrtf(j);
+
+	if (!s->active) {
+		if (m < s->start) {
+			for (i = 0; s->gravity && i < 3; ++i)
+				s->low[i] += XWII__SWING_GRAVITY * d[i];
+			return 0;
+		}
+
+		s->active = true;
+		s->rising = true;
+		s->hit = false;
+		s->quiet = 0;
+		s->peak = m;
+		s->peak_time = ev->time;
+		swing_event(&out[n++], &ev->time, XWII_SWING_START, iface, m);
+	} else if (s->rising) {
+		if (m > s->peak) {
+			s->peak = m;
+			s->peak_time = ev->time;
+		} else if (m < s->peak * XWII__SWING_DROP) {
+			s->rising = false;
+			s->trough = m;
+			swing_event(&out[n++], &s->peak_time, XWII_SWING_PEAK,
+				    iface, s->peak);
+		}
+	} else if (m < s->trough) {
+		s->trough = m;
+	} else if (m >= s->start && m * XWII__SWING_DROP > s->trough) {
+		s->rising = true;
+		s->peak = m;
+		s->peak_time = ev->time;
+	}
+
+	if (s->impact > 0.0f && !s->hit && j >= s->impact) {
+		s->hit = true;
+		swing_event(&out[n++], &ev->time, XWII_SWING_IMPACT, iface, j);
+	}
+
+	still = s->start * XWII__SWING_STILL;
+	quiet = m < s->start * 0.5f;
+	if (s->gravity && j < still && fabsf(sqrtf(r) - sqrtf(g)) < still)
+		quiet = true;
+
+	if (!quiet) {
+		s->quiet = 0;
+	} else if (++s->quiet >= XWII__SWING_QUIET) {
+		s->active = false;
+		if (s->gravity)
+			memcpy(s->low, v, sizeof(s->low));
+	}
+
+	return n;
+}
@@ -0,0 +1,68 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Swing Detection
+ * Start, peak and impact detection on the magnitude of accelerometer or
+ * Motion-Plus samples. Nothing in here allocates memory and nothing in here
+ * is part of the public API.
+ */
+
+#ifndef XWII_SWING_H
+#define XWII_SWING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "xwiimote.h"
+
+/* gravity low-pass smoothing factor per sample */
+#define XWII__SWING_GRAVITY 0.05f
+/* a peak is confirmed once the magnitude drops below this fraction of it */
+#define XWII__SWING_DROP 0.8f
+/* a swing ends after this many samples below half the start threshold */
+#define XWII__SWING_QUIET 5
+/*
+ * accelerometer samples also count as quiet if they change less than this
+ * fraction of the start threshold per sample and their raw magnitude is as
+ * close to the one of gravity
+ */
+#define XWII__SWING_STILL 0.1f
+
+/* swing state; plain data so it can be embedded into xwii_iface */
+struct xwii__swing {
+	/* thresholds, start of 0 disables detection */
+	float start;
+	float impact;
+	/* remove gravity with a low-pass, used for accelerometer data */
+	bool gravity;
+	bool init;
+	/* set during a swing, and until its current peak is confirmed */
+	bool active;
+	bool rising;
+	float low[3];
+	float prev[3];
+	/* highest magnitude since the last peak, and its time */
+	float peak;
+	struct timeval peak_time;
+	/* lowest magnitude since the last peak */
+	float trough;
+	unsigned int quiet;
+	bool hit;
+};
+
+/* reset \s and set thresholds; \gravity as above */
+void xwii__swing_init(struct xwii__swing *s, float start, float impact,
+		      bool gravity);
+/*
+ * process sample \v of event \ev in g or rad/s; fills up to two events in
+ * \out and returns their number
+ */
+unsigned int xwii__swing_update(struct xwii__swing *s,
+				const struct xwii_event *ev, const float v[3],
+				unsigned int iface, struct xwii_event out[2]);
+
+#endif /* XWII_SWING_H */
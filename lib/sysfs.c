@@ -0,0 +1,256 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Sysfs Discovery Backend
+ * Without libudev we read device information straight from sysfs and listen
+ * for kernel uevents on a NETLINK_KOBJECT_UEVENT socket. This does not depend
+ * on a running udev daemon, but we only see raw kernel events, that is, no
+ * rules have been applied and device nodes may not have been created, yet.
+ * Device nodes are expected at the kernel-provided DEVNAME below /dev, which
+ * is what devtmpfs provides.
+ *
+ * For benchmarks and tests, the environment variable XWII_SYSFS_ROOT can point
+ * the backend to a fake sysfs tree instead of /sys. Device nodes are then
+ * expected below dev/ within the tree and may be FIFOs fed with input events.
+ * It is ignored in secure execution mode, for instance in setuid programs.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/netlink.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sysfs.h"
+
+struct xwii__umon {
+	int fd;
+};
+
+const char *xwii__sysfs_root(void)
+{
+	const char *root = secure_getenv("XWII_SYSFS_ROOT");
+
+	return root && *root ? root : XWII__SYSFS_ROOT;
+}
+
+bool xwii__sysfs_fake(void)
+{
+	return strcmp(xwii__sysfs_root(), XWII__SYSFS_ROOT);
+}
+
+int xwii__sysfs_read_attr(const char *dir, const char *attr,
+			  char *buf, size_t size)
+{
+	char path[PATH_MAX];
+	FILE *f;
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", dir, attr);
+	if (ret < 0 || ret >= sizeof(path))
+		return -EINVAL;
+
+	f = fopen(path, "re");
+	if (!f)
+		return -errno;
+
+	if (!fgets(buf, size, f)) {
+		if (ferror(f)) {
+			fclose(f);
+			return errno ? -errno : -EINVAL;
+		}
+		buf[0] = 0;
+	}
+
+	fclose(f);
+	buf[strcspn(buf, "\n")] = 0;
+	return 0;
+}
+
+int xwii__sysfs_read_uevent(const char *dir, const char *key,
+			    char *buf, size_t size)
+{
+	char path[PATH_MAX], line[512];
+	size_t len;
+	FILE *f;
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/uevent", dir);
+	if (ret < 0 || ret >= sizeof(path))
+		return -EINVAL;
+
+	f = fopen(path, "re");
+	if (!f)
+		return -errno;
+
+	len = strlen(key);
+	ret = -ENOENT;
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, key, len) || line[len] != '=')
+			continue;
+
+		line[strcspn(line, "\n")] = 0;
+		if (strlen(&line[len + 1]) >= size) {
+			ret = -ENOBUFS;
+		} else {
+			strcpy(buf, &line[len + 1]);
+			ret = 0;
+		}
+		break;
+	}
+
+	fclose(f);
+	return ret;
+}
+
+int xwii__sysfs_read_link(const char *dir, const char *link,
+			  char *buf, size_t size)
+{
+	char path[PATH_MAX], target[PATH_MAX];
+	const char *base;
+	ssize_t len;
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", dir, link);
+	if (ret < 0 || ret >= sizeof(path))
+		return -EINVAL;
+
+	len = readlink(path, target, sizeof(target) - 1);
+	if (len < 0)
+		return -errno;
+	target[len] = 0;
+
+	base = strrchr(target, '/');
+	base = base ? base + 1 : target;
+	if (strlen(base) >= size)
+		return -ENOBUFS;
+
+	strcpy(buf, base);
+	return 0;
+}
+
+bool xwii__sysfs_is_wiimote(const char *syspath)
+{
+	char name[64];
+
+	if (xwii__sysfs_read_link(syspath, "driver", name, sizeof(name)) ||
+	    strcmp(name, "wiimote"))
+		return false;
+	if (xwii__sysfs_read_link(syspath, "subsystem", name, sizeof(name)) ||
+	    strcmp(name, "hid"))
+		return false;
+
+	return true;
+}
+
+struct xwii__umon *xwii__umon_new(void)
+{
+	struct xwii__umon *umon;
+	struct sockaddr_nl addr;
+
+	umon = malloc(sizeof(*umon));
+	if (!umon)
+		return NULL;
+
+	umon->fd = socket(AF_NETLINK,
+			  SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			  NETLINK_KOBJECT_UEVENT);
+	if (umon->fd < 0)
+		goto err_free;
+
+	/* multicast group 1 carries raw kernel uevents */
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1;
+	if (bind(umon->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+		goto err_fd;
+
+	return umon;
+
+err_fd:
+	close(umon->fd);
+err_free:
+	free(umon);
+	return NULL;
+}
+
+void xwii__umon_unref(struct xwii__umon *umon)
+{
+	if (!umon)
+		return;
+
+	close(umon->fd);
+	free(umon);
+}
+
+int xwii__umon_get_fd(struct xwii__umon *umon)
+{
+	return umon ? umon->fd : -1;
+}
+
+/*
+ * Receive a single uevent. Messages which were not sent by the kernel are
+ * silently dropped. Returns -EAGAIN if no message is queued.
+ * A kernel uevent is a header "<action>@<devpath>" followed by a list of
+ * zero-terminated KEY=value pairs.
+ */
+int xwii__umon_receive(struct xwii__umon *umon, struct xwii__uevent *ev)
+{
+	struct sockaddr_nl addr;
+	socklen_t alen;
+	ssize_t len;
+	size_t off;
+	char *s;
+
+	while (true) {
+		alen = sizeof(addr);
+		len = recvfrom(umon->fd, ev->buf, sizeof(ev->buf) - 1, 0,
+			       (struct sockaddr*)&addr, &alen);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		/* only the kernel may send on group 1 with port 0 */
+		if (alen != sizeof(addr) || addr.nl_pid != 0)
+			continue;
+
+		ev->buf[len] = 0;
+		if (!strchr(ev->buf, '@'))
+			continue;
+
+		ev->action = NULL;
+		ev->devpath = NULL;
+		ev->subsystem = NULL;
+		ev->driver = NULL;
+		ev->devname = NULL;
+
+		for (off = strlen(ev->buf) + 1; off < len;
+		     off += strlen(s) + 1) {
+			s = &ev->buf[off];
+			if (!strncmp(s, "ACTION=", 7))
+				ev->action = &s[7];
+			else if (!strncmp(s, "DEVPATH=", 8))
+				ev->devpath = &s[8];
+			else if (!strncmp(s, "SUBSYSTEM=", 10))
+				ev->subsystem = &s[10];
+			else if (!strncmp(s, "DRIVER=", 7))
+				ev->driver = &s[7];
+			else if (!strncmp(s, "DEVNAME=", 8))
+				ev->devname = &s[8];
+		}
+
+		if (!ev->action || !ev->devpath)
+			continue;
+
+		return 0;
+	}
+}
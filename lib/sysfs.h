@@ -0,0 +1,65 @@
+/*
+ * XWiimote - lib
+ * Written 2010-2013 by David Herrmann <dh.herrmann@gmail.com>
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Sysfs Discovery Backend
+ * Small helpers to access sysfs directly and to receive raw kernel uevents.
+ * These are used instead of libudev if the library is built without it (see
+ * --disable-udev). Nothing in here is part of the public API.
+ */
+
+#ifndef XWII_SYSFS_H
+#define XWII_SYSFS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define XWII__SYSFS_ROOT "/sys"
+/* driver directory relative to the sysfs root */
+#define XWII__SYSFS_WIIMOTE_DRIVER "/bus/hid/drivers/wiimote"
+
+/*
+ * sysfs mount point, XWII__SYSFS_ROOT unless the environment variable
+ * XWII_SYSFS_ROOT points to a fake tree
+ */
+const char *xwii__sysfs_root(void);
+/*
+ * true if running on a fake tree; its device nodes are below dev/ within the
+ * tree and may be FIFOs, which have no evdev name
+ */
+bool xwii__sysfs_fake(void);
+
+/* read first line of \dir/\attr into \buf with trailing newline stripped */
+int xwii__sysfs_read_attr(const char *dir, const char *attr,
+			  char *buf, size_t size);
+/* read value of \key from \dir/uevent into \buf */
+int xwii__sysfs_read_uevent(const char *dir, const char *key,
+			    char *buf, size_t size);
+/* resolve symlink \dir/\link and store its basename in \buf */
+int xwii__sysfs_read_link(const char *dir, const char *link,
+			  char *buf, size_t size);
+/* return true if \syspath is a HID device bound to hid-wiimote */
+bool xwii__sysfs_is_wiimote(const char *syspath);
+
+/* parsed kernel uevent; all strings point into \buf or are NULL */
+struct xwii__uevent {
+	char buf[8192];
+	const char *action;
+	const char *devpath;
+	const char *subsystem;
+	const char *driver;
+	const char *devname;
+};
+
+/* raw kernel uevent monitor */
+struct xwii__umon;
+
+struct xwii__umon *xwii__umon_new(void);
+void xwii__umon_unref(struct xwii__umon *umon);
+int xwii__umon_get_fd(struct xwii__umon *umon);
+int xwii__umon_receive(struct xwii__umon *umon, struct xwii__uevent *ev);
+
+#endif /* XWII_SYSFS_H */
@@ -571,6 +571,103 @@ enum xwii_event_types {
 	 */
 	XWII_EVENT_GONE,
 
+	/**
+	 * Orientation event
+	 *
+	 * Derived from Motion-Plus and accelerometer data if orientation
+	 * fusion is enabled via xwii_iface_set_fusion(). One event is reported
+	 * after each @ref XWII_EVENT_MOTION_PLUS event. The payload is
+	 * struct xwii_event_orientation.
+	 */
+	XWII_EVENT_ORIENTATION,
+
+	/**
+	 * IR pointer event
+	 *
+	 * Derived from IR and accelerometer data if the IR pointer is enabled
+	 * via xwii_iface_set_pointer(). One event is reported after each
+	 * @ref XWII_EVENT_IR event. The payload is struct xwii_event_pointer.
+	 */
+	XWII_EVENT_POINTER,
+
+	/**
+	 * Balance-Board weight event
+	 *
+	 * Derived from balance-board data if weight processing is enabled via
+	 * xwii_iface_set_bboard_weight(). One event is reported after each
+	 * @ref XWII_EVENT_BALANCE_BOARD event. The payload is
+	 * struct xwii_event_weight.
+	 */
+	XWII_EVENT_BALANCE_BOARD_WEIGHT,
+
+	/**
+	 * Calibrated accelerometer event
+	 *
+	 * Calibrated variant of @ref XWII_EVENT_ACCEL, reported after each
+	 * accelerometer event if enabled via
+	 * xwii_iface_set_accel_calibrated(). The payload is
+	 * struct xwii_event_accel.
+	 */
+	XWII_EVENT_ACCEL_CALIBRATED,
+
+	/**
+	 * Gesture event
+	 *
+	 * Reported when the latest accelerometer or Motion-Plus samples match
+	 * a template added via xwii_iface_add_gesture(). The payload is
+	 * struct xwii_event_gesture.
+	 */
+	XWII_EVENT_GESTURE,
+
+	/**
+	 * Swing event
+	 *
+	 * Reported on start, peak and impact of a swing detected on
+	 * accelerometer or Motion-Plus data if enabled via
+	 * xwii_iface_set_swing(). The payload is struct xwii_event_swing.
+	 */
+	XWII_EVENT_SWING,
+
+	/**
+	 * Drum hit event
+	 *
+	 * Reported for each drum or cymbal that was hit if enabled via
+	 * xwii_iface_set_drum_hits(). Hits are detected while decoding the
+	 * drums report and follow the @ref XWII_EVENT_DRUMS_MOVE event of the
+	 * same report, carrying its timestamp. The payload is
+	 * struct xwii_event_drum_hit.
+	 */
+	XWII_EVENT_DRUMS_HIT,
+
+	/**
+	 * Guitar note event
+	 *
+	 * Reported when the strum bar of a guitar is hit if enabled via
+	 * xwii_iface_set_guitar_notes(). It follows the
+	 * @ref XWII_EVENT_GUITAR_KEY event of the strum bar and carries its
+	 * timestamp. The payload is struct xwii_event_guitar_note.
+	 */
+	XWII_EVENT_GUITAR_NOTE,
+
+	/**
+	 * Analog stick event
+	 *
+	 * Normalized stick positions of nunchuk, classic or pro controllers,
+	 * reported after each MOVE event of an interface whose sticks are set
+	 * to @ref XWII_STICK_FLOAT via xwii_iface_set_stick(). The payload is
+	 * struct xwii_event_stick.
+	 */
+	XWII_EVENT_STICK,
+
+	/**
+	 * Frame event
+	 *
+	 * Data of all interfaces reported for a single HID report, if enabled
+	 * via xwii_iface_set_frames(). The payload is
+	 * struct xwii_event_frame.
+	 */
+	XWII_EVENT_FRAME,
+
 	/**
 	 * Number of available event types
 	 *
@@ -765,6 +862,264 @@ enum xwii_drums_abs {
 	XWII_DRUMS_ABS_NUM,
 };
 
+/**
+ * Orientation Payload
+ *
+ * Payload of @ref XWII_EVENT_ORIENTATION events. Axes are given in the frame
+ * of the accelerometer, that is, x points to the right, y points towards the
+ * front and z points upwards if the remote lies flat on a table.
+ */
+struct xwii_event_orientation {
+	/**
+	 * Unit quaternion (w, x, y, z) which rotates the device frame into
+	 * the world frame. Yaw is not drift-corrected.
+	 */
+	float quat[4];
+	/**
+	 * Acceleration in g with gravity removed, in the device frame. This is
+	 * 0 if no accelerometer sample was available for this event.
+	 */
+	float accel[3];
+};
+
+/**
+ * IR Pointer Payload
+ *
+ * Payload of @ref XWII_EVENT_POINTER events. The cursor position is the center
+ * of the sensor bar as seen by the IR camera, with the roll of the device
+ * compensated. Both coordinates are 0 if the device points at the center of
+ * the sensor bar and roughly -1 or 1 at the edges of the camera's field of
+ * view. Positive x is right, positive y is down.
+ */
+struct xwii_event_pointer {
+	/** horizontal cursor position */
+	float x;
+	/** vertical cursor position */
+	float y;
+	/** estimated distance to the sensor bar in meters or 0 */
+	float distance;
+	/** roll of the device around its long axis in radians */
+	float roll;
+	/**
+	 * number of sensor bar dots seen; 2 if both are visible, 1 if the
+	 * second dot was extrapolated and 0 if no pointer is available. In
+	 * the latter case the last known position is reported.
+	 */
+	unsigned int dots;
+};
+
+/**
+ * Balance-Board Step Events
+ *
+ * Reported in the step field of struct xwii_event_weight.
+ */
+enum xwii_bboard_step {
+	/** no change */
+	XWII_BBOARD_STEP_NONE,
+	/** someone stepped onto the board */
+	XWII_BBOARD_STEP_ON,
+	/** the board was left */
+	XWII_BBOARD_STEP_OFF,
+};
+
+/**
+ * Balance-Board Weight Payload
+ *
+ * Payload of @ref XWII_EVENT_BALANCE_BOARD_WEIGHT events. All weights are
+ * low-pass filtered and have the tare offset subtracted, see
+ * xwii_iface_tare_bboard().
+ */
+struct xwii_event_weight {
+	/**
+	 * weight per sensor in kg, in the same order as the
+	 * @ref XWII_EVENT_BALANCE_BOARD payload: top-right, bottom-right,
+	 * top-left and bottom-left
+	 */
+	float kg[4];
+	/** total weight in kg */
+	float total;
+	/**
+	 * center of pressure in cm relative to the center of the board;
+	 * positive x is right, positive y is top. Both are 0 if the total
+	 * weight is below 1 kg.
+	 */
+	float cop_x;
+	float cop_y;
+	/** step transition as enum xwii_bboard_step */
+	unsigned int step;
+	/** non-zero while the total weight is stable */
+	unsigned int stable;
+};
+
+/**
+ * Calibrated Accelerometer Payload
+ *
+ * Payload of @ref XWII_EVENT_ACCEL_CALIBRATED events.
+ */
+struct xwii_event_accel {
+	/** acceleration in g, axes as reported by @ref XWII_EVENT_ACCEL */
+	float x;
+	float y;
+	float z;
+	/**
+	 * angle of the long axis against the horizon in radians, positive
+	 * if the front points up; 0 unless @ref XWII_ACCEL_TILT is set
+	 */
+	float pitch;
+	/**
+	 * rotation around the long axis in radians, 0 if lying flat;
+	 * 0 unless @ref XWII_ACCEL_TILT is set
+	 */
+	float roll;
+};
+
+/**
+ * Gesture Payload
+ *
+ * Payload of @ref XWII_EVENT_GESTURE events.
+ */
+struct xwii_event_gesture {
+	/** template identifier as passed to xwii_iface_add_gesture() */
+	unsigned int id;
+	/** interface the gesture was detected on */
+	unsigned int iface;
+	/**
+	 * mean squared distance per sample between the template and the
+	 * movement, in raw units; lower is a closer match
+	 */
+	float distance;
+};
+
+/**
+ * Swing phases
+ *
+ * Phase of @ref XWII_EVENT_SWING events.
+ */
+enum xwii_swing_phase {
+	/** magnitude crossed the start threshold */
+	XWII_SWING_START,
+	/**
+	 * magnitude peaked; the event carries the time of the peak sample,
+	 * which is usually one sample before the event is reported
+	 */
+	XWII_SWING_PEAK,
+	/** change between two samples crossed the impact threshold */
+	XWII_SWING_IMPACT,
+};
+
+/**
+ * Swing Payload
+ *
+ * Payload of @ref XWII_EVENT_SWING events.
+ */
+struct xwii_event_swing {
+	/** phase as enum xwii_swing_phase */
+	unsigned int phase;
+	/** interface the swing was detected on */
+	unsigned int iface;
+	/**
+	 * magnitude for start and peak, change between the two samples for
+	 * impacts; in g for the accelerometer (gravity removed) and rad/s for
+	 * Motion-Plus
+	 */
+	float strength;
+};
+
+/**
+ * Drum Hit Payload
+ *
+ * Payload of @ref XWII_EVENT_DRUMS_HIT events.
+ */
+struct xwii_event_drum_hit {
+	/** drum or cymbal that was hit as enum xwii_drums_abs */
+	unsigned int drum;
+	/** pressure reported for the hit, as in @ref XWII_EVENT_DRUMS_MOVE */
+	int32_t velocity;
+};
+
+/**
+ * Guitar frets
+ *
+ * Bits of the fret mask of @ref XWII_EVENT_GUITAR_NOTE events.
+ */
+enum xwii_guitar_frets {
+	/** @ref XWII_KEY_FRET_FAR_UP is pressed */
+	XWII_GUITAR_FRET_FAR_UP = 0x01,
+	/** @ref XWII_KEY_FRET_UP is pressed */
+	XWII_GUITAR_FRET_UP = 0x02,
+	/** @ref XWII_KEY_FRET_MID is pressed */
+	XWII_GUITAR_FRET_MID = 0x04,
+	/** @ref XWII_KEY_FRET_LOW is pressed */
+	XWII_GUITAR_FRET_LOW = 0x08,
+	/** @ref XWII_KEY_FRET_FAR_LOW is pressed */
+	XWII_GUITAR_FRET_FAR_LOW = 0x10,
+};
+
+/**
+ * Guitar Note Payload
+ *
+ * Payload of @ref XWII_EVENT_GUITAR_NOTE events. Whammy and slider values are
+ * given as in @ref XWII_EVENT_GUITAR_MOVE events, deltas are relative to the
+ * previous note.
+ */
+struct xwii_event_guitar_note {
+	/** frets held at strum time as enum xwii_guitar_frets */
+	unsigned int frets;
+	/** @ref XWII_KEY_STRUM_BAR_UP or @ref XWII_KEY_STRUM_BAR_DOWN */
+	unsigned int strum;
+	/** whammy bar position and change since the previous note */
+	int32_t whammy;
+	int32_t whammy_delta;
+	/** fret-board slider position and change since the previous note */
+	int32_t slider;
+	int32_t slider_delta;
+};
+
+/**
+ * Analog Stick Payload
+ *
+ * Payload of @ref XWII_EVENT_STICK events. Sticks are ordered as in the MOVE
+ * events of the interface; positions are in -1..1 with the signs of the raw
+ * values.
+ */
+struct xwii_event_stick {
+	/** interface the sticks belong to */
+	unsigned int iface;
+	/** number of valid sticks */
+	unsigned int num;
+	/** position per stick */
+	float x[2];
+	float y[2];
+};
+
+/**
+ * Frame Payload
+ *
+ * Payload of @ref XWII_EVENT_FRAME events. The event carries the kernel
+ * timestamp shared by all parts of the frame. Only parts of interfaces set in
+ * @p ifaces were reported for this frame, all others are 0. Key state is
+ * always valid.
+ */
+struct xwii_event_frame {
+	/** bitmask of interfaces that reported data for this frame */
+	unsigned int ifaces;
+	/** pressed core keys; bit n is set if key code n is pressed */
+	uint32_t keys;
+	/** pressed extension keys, as @p keys */
+	uint32_t ext_keys;
+	/** data of @ref XWII_EVENT_ACCEL */
+	struct xwii_event_abs accel;
+	/** data of @ref XWII_EVENT_MOTION_PLUS */
+	struct xwii_event_abs gyro;
+	/** x and y of each IR slot as in @ref XWII_EVENT_IR */
+	int16_t ir[4][2];
+	/**
+	 * data of the MOVE event of nunchuk, classic controller, pro
+	 * controller, guitar or balance board, laid out as in that event
+	 */
+	struct xwii_event_abs ext[4];
+};
+
 /** Number of ABS values in an xwii_event_union */
 #define XWII_ABS_NUM 8
 
@@ -778,6 +1133,26 @@ union xwii_event_union {
 	struct xwii_event_key key;
 	/** absolute motion event payload */
 	struct xwii_event_abs abs[XWII_ABS_NUM];
+	/** orientation event payload */
+	struct xwii_event_orientation orientation;
+	/** IR pointer event payload */
+	struct xwii_event_pointer pointer;
+	/** balance-board weight event payload */
+	struct xwii_event_weight weight;
+	/** calibrated accelerometer event payload */
+	struct xwii_event_accel accel;
+	/** gesture event payload */
+	struct xwii_event_gesture gesture;
+	/** swing event payload */
+	struct xwii_event_swing swing;
+	/** drum hit event payload */
+	struct xwii_event_drum_hit drum_hit;
+	/** guitar note event payload */
+	struct xwii_event_guitar_note guitar_note;
+	/** analog stick event payload */
+	struct xwii_event_stick stick;
+	/** frame event payload */
+	struct xwii_event_frame frame;
 	/** reserved; do not use! */
 	uint8_t reserved[128];
 };
@@ -801,6 +1176,50 @@ struct xwii_event {
 	union xwii_event_union v;
 };
 
+/** Maximum size of a compact event record in bytes */
+#define XWII_COMPACT_MAX 32
+
+/**
+ * Compact event
+ *
+ * Alternative encoding of kernel events as returned by
+ * xwii_iface_dispatch_compact(). A record is 16, 24 or 32 bytes as given by
+ * @p size; only that many bytes are written, so records can be stored back to
+ * back. Padding is zero. The values in @p v depend on the event type:
+ *  - key events: @p s[0] is the key code, @p s[1] the key state
+ *  - @ref XWII_EVENT_ACCEL and @ref XWII_EVENT_MOTION_PLUS: @p l[0] to
+ *    @p l[2] are x, y and z
+ *  - @ref XWII_EVENT_IR: @p s[2n] and @p s[2n + 1] are x and y of slot n
+ *  - @ref XWII_EVENT_BALANCE_BOARD: @p l[0] to @p l[3] are the x values
+ *  - @ref XWII_EVENT_NUNCHUK_MOVE: @p s[0] and @p s[1] are the stick, @p s[2]
+ *    to @p s[4] the accelerometer
+ *  - @ref XWII_EVENT_CLASSIC_CONTROLLER_MOVE and
+ *    @ref XWII_EVENT_PRO_CONTROLLER_MOVE: @p s[2n] and @p s[2n + 1] are x and
+ *    y of payload n
+ *  - @ref XWII_EVENT_GUITAR_MOVE: @p s[0] and @p s[1] are the stick, @p s[2]
+ *    the whammy bar and @p s[3] the fret bar
+ *  - @ref XWII_EVENT_DRUMS_MOVE: @p s[0] and @p s[1] are the pad, @p s[n + 1]
+ *    the pressure of payload n of enum xwii_drums_abs
+ *  - @ref XWII_EVENT_WATCH and @ref XWII_EVENT_GONE: no values
+ */
+struct xwii_compact_event {
+	/** timestamp in nanoseconds, same clock as struct xwii_event */
+	uint64_t time;
+	/** event type, see enum xwii_event_types */
+	uint16_t type;
+	/** size of this record in bytes */
+	uint8_t size;
+	/** number of values in @p v */
+	uint8_t num;
+	/** payload values */
+	union {
+		/** 16 bit values */
+		int16_t s[10];
+		/** 32 bit values */
+		int32_t l[5];
+	} v;
+};
+
 /**
  * Test whether an IR event is valid
  *
@@ -957,6 +1376,40 @@ enum xwii_led {
  */
 int xwii_iface_new(struct xwii_iface **dev, const char *syspath);
 
+/**
+ * Construction flags
+ *
+ * Flags that can be passed to xwii_iface_new_flags(). These are bit-masks that
+ * can be binary-ORed.
+ */
+enum xwii_new_flags {
+	/**
+	 * Defer interface discovery
+	 *
+	 * Only validate the device during construction. The device is scanned
+	 * for interfaces, LEDs and batteries on first use, that is, on the
+	 * first call to xwii_iface_open(), xwii_iface_available() or any of
+	 * the LED and battery helpers.
+	 */
+	XWII_NEW_LAZY			= 0x000001,
+};
+
+/**
+ * Create new device object from syspath path with flags
+ *
+ * @param[out] dev Pointer to new opaque device is stored here
+ * @param[in] syspath Sysfs path to root device node
+ * @param[in] flags Bitmask of enum xwii_new_flags
+ *
+ * Same as xwii_iface_new() but allows to modify the construction via @p flags.
+ * If many devices are set up at once, @ref XWII_NEW_LAZY can be used to
+ * construct them quickly and only scan those that are actually used.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_new_flags(struct xwii_iface **dev, const char *syspath,
+			 unsigned int flags);
+
 /**
  * Increase ref-count by 1
  *
@@ -1081,6 +1534,162 @@ unsigned int xwii_iface_opened(struct xwii_iface *dev);
  */
 unsigned int xwii_iface_available(struct xwii_iface *dev);
 
+/**
+ * Set on-demand policy for interfaces
+ *
+ * @param[in] dev Valid device object
+ * @param[in] ifaces Bitmask of interfaces of type enum xwii_iface_type
+ * @param[in] idle_ms Idle window in milliseconds
+ *
+ * The kernel enables accelerometer, IR and MotionPlus reporting only while the
+ * related interface is open. The bluetooth report size and rate, and thus
+ * latency and battery life, depend on which of them are open. This marks the
+ * interfaces in @p ifaces as on-demand interfaces. They are opened by
+ * xwii_iface_demand() or xwii_iface_subscribe() and automatically closed if
+ * they were neither demanded, read nor subscribed within the last @p idle_ms
+ * milliseconds. Every event read from such an interface counts as demand, so
+ * an application that keeps dispatching its events keeps it open. If
+ * @ref XWII_IFACE_WRITABLE is set in @p ifaces, the interfaces are opened
+ * writable.
+ *
+ * This is mostly useful for @ref XWII_IFACE_ACCEL, @ref XWII_IFACE_IR and
+ * @ref XWII_IFACE_MOTION_PLUS. Interfaces that are closed by this policy do
+ * not cause an @ref XWII_EVENT_WATCH event. Pass 0 as @p ifaces to disable the
+ * policy. Interfaces that are currently open are not touched by that.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_set_demand_policy(struct xwii_iface *dev, unsigned int ifaces,
+				 unsigned int idle_ms);
+
+/**
+ * Signal demand for on-demand interfaces
+ *
+ * @param[in] dev Valid device object
+ * @param[in] ifaces Bitmask of interfaces of type enum xwii_iface_type
+ *
+ * Opens all on-demand interfaces in @p ifaces that are not open, yet, and
+ * keeps them open for another idle window. Reading events of an interface
+ * does the same, so this is only needed to open an interface or to keep it
+ * open while its data is not read. Interfaces that are not managed on demand
+ * are ignored. See xwii_iface_set_demand_policy().
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_demand(struct xwii_iface *dev, unsigned int ifaces);
+
+/**
+ * Subscribe to on-demand interfaces
+ *
+ * @param[in] dev Valid device object
+ * @param[in] ifaces Bitmask of interfaces of type enum xwii_iface_type
+ * @param[in] subscribe Whether to subscribe or unsubscribe
+ *
+ * Subscribed on-demand interfaces are opened and never closed by the
+ * on-demand policy. Once unsubscribed, they are closed after one idle window
+ * unless they are demanded again. See xwii_iface_set_demand_policy().
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_subscribe(struct xwii_iface *dev, unsigned int ifaces,
+			 bool subscribe);
+
+/**
+ * Reopen interfaces automatically on hotplug
+ *
+ * @param[in] dev Valid device object
+ * @param[in] ifaces Bitmask of interfaces of type enum xwii_iface_type
+ *
+ * Whenever an interface in @p ifaces becomes available due to hotplug events
+ * (for instance, an extension was plugged), it is opened by the library right
+ * away. If @ref XWII_IFACE_WRITABLE is set, interfaces are opened writable.
+ * @ref XWII_EVENT_WATCH is still reported, but applications no longer need to
+ * reopen these interfaces themselves, which avoids losing samples during the
+ * round-trip. On-demand interfaces (see xwii_iface_set_demand_policy()) are
+ * only reopened while they are demanded or subscribed.
+ *
+ * The gap between the last event before and the first event after such a
+ * reopen is recorded in struct xwii_iface_stats. Pass 0 to disable automatic
+ * reopening, which is also the initial state.
+ */
+void xwii_iface_set_auto_open(struct xwii_iface *dev, unsigned int ifaces);
+
+/**
+ * Device Statistics
+ *
+ * Runtime statistics of a device object. New fields may be appended in future
+ * revisions, see xwii_iface_get_stats(). All durations are in microseconds
+ * and derived from kernel event timestamps.
+ */
+struct xwii_iface_stats {
+	/** number of interfaces reopened via xwii_iface_set_auto_open() */
+	uint64_t reopen_count;
+	/** number of measured reopen gaps */
+	uint64_t reopen_gap_num;
+	/** sum of all measured reopen gaps */
+	uint64_t reopen_gap_total;
+	/** most recent reopen gap */
+	uint64_t reopen_gap_last;
+	/** largest reopen gap */
+	uint64_t reopen_gap_max;
+	/** number of MOVE events dropped by xwii_iface_set_deadband() */
+	uint64_t deadband_dropped;
+	/** number of reports dropped or averaged by xwii_iface_set_rate() */
+	uint64_t rate_dropped;
+	/** number of derived events, like drum hits, lost to a full queue */
+	uint64_t pending_dropped;
+};
+
+/**
+ * Read device statistics
+ *
+ * @param[in] dev Valid device object
+ * @param[out] stats Pointer where to store the statistics
+ * @param[in] size Size of @p stats
+ *
+ * Copies the current statistics of @p dev into @p stats. The @p size argument
+ * provides backwards compatibility, in case struct xwii_iface_stats grows.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_get_stats(struct xwii_iface *dev,
+			 struct xwii_iface_stats *stats, size_t size);
+
+/** Number of threads used by xwii_iface_new_many() if 0 is passed */
+#define XWII_BULK_DEFAULT_THREADS 4
+/** Maximum number of threads used by xwii_iface_new_many() */
+#define XWII_BULK_MAX_THREADS 16
+
+/**
+ * Create and open many device objects concurrently
+ *
+ * @param[out] devs Array of @p num entries where the new objects are stored
+ * @param[out] errs Array of @p num entries where per-device results are stored
+ * @param[in] syspaths Array of @p num sysfs paths to root device nodes
+ * @param[in] num Number of devices
+ * @param[in] ifaces Bitmask of interfaces to open or 0
+ * @param[in] threads Number of threads to use or 0 for the default
+ *
+ * This is equivalent to calling xwii_iface_new() and xwii_iface_open() for each
+ * path in @p syspaths, but the devices are set up concurrently on up to
+ * @p threads threads (including the calling thread). Device setup is dominated
+ * by sysfs scans and kernel round-trips, so setting up many devices takes
+ * roughly as long as the slowest single device.
+ *
+ * For each index, @p devs contains the new object or NULL if it could not be
+ * created. @p errs contains 0 on success or the negative error code of
+ * xwii_iface_new() or xwii_iface_open(). If only opening failed, the object is
+ * still returned in @p devs and you can use xwii_iface_opened() to see which
+ * interfaces are open. All returned objects must be released via
+ * xwii_iface_unref(). Each object is independent and must not be used from
+ * multiple threads without locking.
+ *
+ * @returns Number of created objects, or negative error code on failure
+ */
+int xwii_iface_new_many(struct xwii_iface **devs, int *errs,
+			const char *const *syspaths, size_t num,
+			unsigned int ifaces, unsigned int threads);
+
 /**
  * Read incoming event-queue
  *
@@ -1130,6 +1739,12 @@ int xwii_iface_poll(struct xwii_iface *dev, struct xwii_event *ev);
  * function in a row as long as it returns 0. It stores the event in @p ev which
  * you can then handle in your application.
  *
+ * Events derived by the library, like @ref XWII_EVENT_ORIENTATION, are queued
+ * internally and returned before any new kernel event is read. They do not
+ * make the file-descriptor readable, so always call this function until it
+ * returns -EAGAIN. If the internal queue overflows, the oldest derived events
+ * are lost and counted in struct xwii_iface_stats.
+ *
  * This function is the successor or xwii_iface_poll(). It takes an additional
  * @p size argument to provide backwards compatibility.
  *
@@ -1139,6 +1754,30 @@ int xwii_iface_poll(struct xwii_iface *dev, struct xwii_event *ev);
 int xwii_iface_dispatch(struct xwii_iface *dev, struct xwii_event *ev,
 			size_t size);
 
+/**
+ * Read incoming event-queue in compact encoding
+ *
+ * @param[in] dev Valid device object
+ * @param[out] buf Buffer where to store a single struct xwii_compact_event
+ * @param[in] size Size of @p buf, at least @ref XWII_COMPACT_MAX
+ *
+ * Works like xwii_iface_dispatch() but stores the next event as
+ * struct xwii_compact_event, writing only as many bytes as the record needs.
+ * The full struct xwii_event is never cleared or copied, which saves memory
+ * bandwidth when buffering or forwarding many events. @p buf needs no
+ * particular alignment.
+ *
+ * Only kernel event types have a compact encoding. Events derived by the
+ * library, like @ref XWII_EVENT_ORIENTATION or @ref XWII_EVENT_FRAME, are
+ * skipped, so do not enable them when reading events via this function.
+ *
+ * @returns size of the stored record in bytes on success, -EAGAIN if no event
+ * can be read, -EINVAL if @p buf is NULL or too small and a negative
+ * error-code on failure
+ */
+int xwii_iface_dispatch_compact(struct xwii_iface *dev, void *buf,
+				size_t size);
+
 /**
  * Toggle rumble motor
  *
@@ -1249,6 +1888,9 @@ int xwii_iface_get_extension(struct xwii_iface *dev, char **extension);
  * the factor is used to re-calibrate the zero-point of MP data depending on MP
  * input. This is an angoing calibration which modifies the internal state of
  * the x, y and z values.
+ *
+ * See xwii_iface_set_mp_bias_estimation() for a calibration that only adapts
+ * while the device is at rest.
  */
 void xwii_iface_set_mp_normalization(struct xwii_iface *dev, int32_t x,
 				     int32_t y, int32_t z, int32_t factor);
@@ -1275,43 +1917,904 @@ void xwii_iface_set_mp_normalization(struct xwii_iface *dev, int32_t x,
 void xwii_iface_get_mp_normalization(struct xwii_iface *dev, int32_t *x,
 				     int32_t *y, int32_t *z, int32_t *factor);
 
-/** @} */
+/**
+ * Set MP bias estimation
+ *
+ * @param[in] dev Valid device object
+ * @param[in] rate Adaption rate in 1/1024 per sample, or 0 to disable
+ *
+ * Enables runtime calibration of MP data that only adapts while the device is
+ * at rest. The library detects rest by looking at the variance of MP data
+ * (and accelerometer data, if that interface is open). While at rest, the
+ * bias is moved towards the measured mean rate by @p rate / 1024 per sample.
+ * During motion it is left untouched, so sustained rotation does not leak
+ * into it. The bias is subtracted from MP data in addition to the values set
+ * via xwii_iface_set_mp_normalization(), whose calibration factor should be
+ * 0 when this is used. A good starting point for @p rate is 50. See
+ * xwii_iface_set_mp_rest_threshold() to tune rest detection.
+ *
+ * @returns the rate in use; rates above 1024 are clamped to 1024
+ */
+uint32_t xwii_iface_set_mp_bias_estimation(struct xwii_iface *dev,
+					   uint32_t rate);
 
 /**
- * @defgroup monitor Device Monitor
- * Monitor system for new wiimote devices.
+ * Read MP bias
  *
- * This monitor can be used to enumerate all connected wiimote devices and also
- * monitoring the system for hotplugged wiimote devices.
- * This is a simple wrapper around libudev and should only be used if your
- * application does not use udev on its own.
- * See the implementation of the monitor to integrate wiimote-monitoring into
- * your own udev routines.
+ * @param[in] dev Valid device object
+ * @param[out] x Pointer where to store x-value or NULL
+ * @param[out] y Pointer where to store y-value or NULL
+ * @param[out] z Pointer where to store z-value or NULL
  *
- * @{
+ * Reads the bias estimated via xwii_iface_set_mp_bias_estimation(), in raw
+ * units on top of the normalization values.
  */
+void xwii_iface_get_mp_bias(struct xwii_iface *dev, int32_t *x, int32_t *y,
+			    int32_t *z);
 
 /**
- * Monitor object
+ * Set MP rest detection thresholds
  *
- * Each object describes a separate monitor. A single monitor must not be
- * used from multiple threads without locking. Different monitors are
- * independent of each other and can be used simultaneously.
+ * @param[in] dev Valid device object
+ * @param[in] gyro Maximum standard deviation of MP data at rest
+ * @param[in] accel Maximum standard deviation of accelerometer data at rest
+ *
+ * MP bias estimation only updates the bias while the device is at rest, see
+ * xwii_iface_set_mp_bias_estimation(). The device is
+ * considered at rest if the standard deviation of each axis stays below these
+ * thresholds for a short period. Both are given in raw units as reported by
+ * the related events. @p accel is only used if the accelerometer interface is
+ * open. Defaults are 100 for @p gyro and 3 for @p accel.
  */
-struct xwii_monitor;
+void xwii_iface_set_mp_rest_threshold(struct xwii_iface *dev, uint32_t gyro,
+				      uint32_t accel);
 
 /**
- * Create a new monitor
+ * Return whether the device is at rest
  *
- * Creates a new monitor and returns a pointer to the opaque object. NULL is
- * returned on failure.
+ * @param[in] dev Valid device object
  *
- * @param[in] poll True if this monitor should watch for hotplug events
- * @param[in] direct True if kernel uevents should be used instead of udevd
+ * Returns true if MP bias estimation is enabled and the device is currently
+ * detected as being at rest. See xwii_iface_set_mp_bias_estimation().
+ */
+bool xwii_iface_is_mp_resting(struct xwii_iface *dev);
+
+/**
+ * Orientation fusion modes
  *
- * A monitor always provides all devices that are available on a system. If
- * @p poll is true, the monitor also sets up a system-monitor to watch the
- * system for new hotplug events so new devices can be detected.
+ * Selects the implementation used to compute @ref XWII_EVENT_ORIENTATION
+ * events, see xwii_iface_set_fusion().
+ */
+enum xwii_fusion_mode {
+	/** orientation fusion disabled (default) */
+	XWII_FUSION_OFF,
+	/** single-precision floating point filter */
+	XWII_FUSION_FLOAT,
+	/** integer-only fixed-point filter for targets without fast FPU */
+	XWII_FUSION_FIXED,
+};
+
+/**
+ * Enable orientation fusion
+ *
+ * @param[in] dev Valid device object
+ * @param[in] mode Fusion mode as enum xwii_fusion_mode
+ * @param[in] gain Accelerometer correction gain or 0 for the default
+ *
+ * If enabled, the library combines Motion-Plus and accelerometer samples into
+ * a device orientation and reports an @ref XWII_EVENT_ORIENTATION event after
+ * each @ref XWII_EVENT_MOTION_PLUS event. Accelerometer samples are paired
+ * with gyro samples by their kernel timestamps. The Motion-Plus interface must
+ * be open. If the accelerometer interface is not open, the orientation is
+ * derived from the gyroscope alone and drifts over time.
+ *
+ * @p gain controls how fast the estimate is pulled towards the measured
+ * gravity. Higher values correct drift faster but let linear acceleration
+ * leak into the orientation. The default is 0.5. Negative gains are rejected,
+ * the result of passing NaN is undefined. Calling this function always resets
+ * the filter state.
+ *
+ * Gyro data is taken after MP normalization and bias estimation, so
+ * combining this with xwii_iface_set_mp_bias_estimation() is recommended.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_set_fusion(struct xwii_iface *dev, unsigned int mode,
+			  float gain);
+
+/**
+ * Enable IR pointer
+ *
+ * @param[in] dev Valid device object
+ * @param[in] enable True to enable, false to disable the IR pointer
+ *
+ * If enabled, the library tracks the two light sources of a sensor bar in IR
+ * data and reports an @ref XWII_EVENT_POINTER event after each
+ * @ref XWII_EVENT_IR event. The IR interface must be open. If the
+ * accelerometer interface is open, too, it is used to find the sensor bar if
+ * tracking was lost and to keep the roll if only one dot is visible.
+ * Enabling the pointer always resets its state.
+ */
+void xwii_iface_set_pointer(struct xwii_iface *dev, bool enable);
+
+/**
+ * Smoothing filter types
+ *
+ * Adaptive filters which can be applied to IR data, see
+ * xwii_iface_set_ir_filter().
+ */
+enum xwii_filter_type {
+	/** no filtering (default) */
+	XWII_FILTER_NONE,
+	/**
+	 * One-Euro filter
+	 *
+	 * Low-pass filter whose cutoff frequency rises with the speed of
+	 * movement. Parameters are the minimum cutoff in Hz (default 1.0), the
+	 * speed coefficient in 1/pixel (default 0.05) and the cutoff used to
+	 * estimate the speed in Hz (default 1.0). Lower the minimum cutoff to
+	 * reduce jitter, raise the speed coefficient to reduce lag.
+	 */
+	XWII_FILTER_ONE_EURO,
+	/**
+	 * Constant-velocity Kalman filter
+	 *
+	 * Parameters are the process noise in pixel^2/s^3 (default 50000),
+	 * the measurement noise in pixel^2 (default 2.0) and the prediction
+	 * time in seconds (default 0). A positive prediction time extrapolates
+	 * the position along the estimated velocity to hide latency.
+	 */
+	XWII_FILTER_KALMAN,
+};
+
+/**
+ * Set IR smoothing filter
+ *
+ * @param[in] dev Valid device object
+ * @param[in] type Filter type as enum xwii_filter_type
+ * @param[in] a First filter parameter or 0 for the default
+ * @param[in] b Second filter parameter or 0 for the default
+ * @param[in] c Third filter parameter or 0 for the default
+ *
+ * Applies an adaptive smoothing filter to each tracked IR slot before
+ * @ref XWII_EVENT_IR events are returned. The IR pointer is derived from the
+ * filtered data, see xwii_iface_set_pointer(). A slot is reset whenever it
+ * loses its IR source or jumps to a different one. The meaning of the
+ * parameters depends on @p type and is given in IR camera pixels. Filters use
+ * the kernel timestamps of the events as time base. Setting a filter always
+ * resets its state.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_iface_set_ir_filter(struct xwii_iface *dev, unsigned int type,
+			     float a, float b, float c);
+
+/**
+ * Enable balance-board weight processing
+ *
+ * @param[in] dev Valid device object
+ * @param[in] enable True to enable, false to disable weight processing
+ *
+ * If enabled, the library converts balance-board data into kilograms and
+ * reports an @ref XWII_EVENT_BALANCE_BOARD_WEIGHT event after each
+ * @ref XWII_EVENT_BALANCE_BOARD event. The kernel already applies the factory
+ * calibration stored on the board. Enabling resets the filters but keeps the
+ * tare offset.
+ */
+void xwii_iface_set_bboard_weight(struct xwii_iface *dev, bool enable);
+
+/**
+ * Tare balance-board
+ *
+ * @param[in] dev Valid device object
+ *
+ * Uses the current filtered weight of each sensor as zero for all following
+ * @ref XWII_EVENT_BALANCE_BOARD_WEIGHT events. The board should be empty.
+ * Weight processing must be enabled via xwii_iface_set_bboard_weight().
+ *
+ * @returns 0 on success, -EAGAIN if no balance-board data was received yet
+ * and a negative error code on failure
+ */
+int xwii_iface_tare_bboard(struct xwii_iface *dev);
+
+/**
+ * Calibrated accelerometer flags
+ *
+ * Flags for xwii_iface_set_accel_calibrated().
+ */
+enum xwii_accel_flags {
+	/** report @ref XWII_EVENT_ACCEL_CALIBRATED events */
+	XWII_ACCEL_CALIBRATED = 0x000001,
+	/** also derive pitch and roll from the gravity vector */
+	XWII_ACCEL_TILT = 0x000002,
+};
+
+/**
+ * Enable calibrated accelerometer events
+ *
+ * @param[in] dev Valid device object
+ * @param[in] flags Bitmask of enum xwii_accel_flags or 0 to disable
+ *
+ * If @ref XWII_ACCEL_CALIBRATED is set, each @ref XWII_EVENT_ACCEL event is
+ * followed by an @ref XWII_EVENT_ACCEL_CALIBRATED event which reports the
+ * same sample in g, see xwii_iface_set_accel_calibration(). If
+ * @ref XWII_ACCEL_TILT is set, too, pitch and roll are derived from it.
+ */
+void xwii_iface_set_accel_calibrated(struct xwii_iface *dev,
+				     unsigned int flags);
+
+/**
+ * Set accelerometer calibration
+ *
+ * @param[in] dev Valid device object
+ * @param[in] zero Raw reading of each axis at 0g or NULL for the default
+ * @param[in] one_g Raw reading of each axis at 1g or NULL for the default
+ *
+ * The kernel reports uncalibrated accelerometer data. Pass the raw readings
+ * of each axis at 0g and at 1g (pointing up) as measured for this device to
+ * get accurate @ref XWII_EVENT_ACCEL_CALIBRATED events. Defaults are 0 and
+ * 100 for each axis, which is close for most devices.
+ *
+ * @returns 0 on success, -EINVAL if @p zero and @p one_g are equal on any
+ * axis
+ */
+int xwii_iface_set_accel_calibration(struct xwii_iface *dev,
+				     const struct xwii_event_abs *zero,
+				     const struct xwii_event_abs *one_g);
+
+/**
+ * Read accelerometer calibration
+ *
+ * @param[in] dev Valid device object
+ * @param[out] zero Pointer where to store the 0g readings or NULL
+ * @param[out] one_g Pointer where to store the 1g readings or NULL
+ */
+void xwii_iface_get_accel_calibration(struct xwii_iface *dev,
+				      struct xwii_event_abs *zero,
+				      struct xwii_event_abs *one_g);
+
+/**
+ * Add gesture template
+ *
+ * @param[in] dev Valid device object
+ * @param[in] id Identifier reported in @ref XWII_EVENT_GESTURE events
+ * @param[in] iface @ref XWII_IFACE_ACCEL or @ref XWII_IFACE_MOTION_PLUS
+ * @param[in] samples Recorded raw samples of the gesture (abs[0] of the
+ * respective events)
+ * @param[in] num Number of samples, 2 to 64
+ * @param[in] threshold Max mean squared distance per sample for a match
+ *
+ * Each new sample of @p iface is matched against all templates of that
+ * interface using dynamic time warping, which tolerates moderate differences
+ * in speed. If at least one template matches the latest samples, an
+ * @ref XWII_EVENT_GESTURE event is reported for the closest one. Afterwards,
+ * the interface is not matched again until as many samples as the template
+ * has were received.
+ *
+ * Several templates may share an identifier, e.g. to record a gesture more
+ * than once. Up to 32 templates can be added per device. @p threshold must be
+ * greater than 0, the result of passing NaN is undefined.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments, -ENOSPC if too many
+ * templates were added and -ENOMEM if out of memory
+ */
+int xwii_iface_add_gesture(struct xwii_iface *dev, unsigned int id,
+			   unsigned int iface,
+			   const struct xwii_event_abs *samples, size_t num,
+			   float threshold);
+
+/**
+ * Remove gesture templates
+ *
+ * @param[in] dev Valid device object
+ * @param[in] id Identifier of the templates to remove
+ *
+ * Removes all templates added with identifier @p id.
+ */
+void xwii_iface_remove_gesture(struct xwii_iface *dev, unsigned int id);
+
+/**
+ * Enable swing detection
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface @ref XWII_IFACE_ACCEL or @ref XWII_IFACE_MOTION_PLUS
+ * @param[in] start Magnitude that starts a swing or 0 to disable
+ * @param[in] impact Change between two samples that is reported as impact
+ * or 0 to disable impacts
+ *
+ * Thresholds are in g for the accelerometer and rad/s for Motion-Plus. The
+ * accelerometer is scaled with the calibration set via
+ * xwii_iface_set_accel_calibration() and gravity is removed. Motion-Plus
+ * data should be calibrated, see xwii_iface_set_mp_bias_estimation().
+ *
+ * Detection runs on each sample right after it was read, so a peak is
+ * reported as soon as the magnitude drops below 80% of it. Each swing reports
+ * one start, one or more peaks and at most one impact. A swing ends once the
+ * magnitude stays low or the remote is held still, in whatever orientation.
+ * Typical values are 1.5 and 3 for the accelerometer and 5 and 10 for
+ * Motion-Plus. Negative thresholds are rejected, the result of passing NaN is
+ * undefined.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments
+ */
+int xwii_iface_set_swing(struct xwii_iface *dev, unsigned int iface,
+			 float start, float impact);
+
+/**
+ * Enable drum hit events
+ *
+ * @param[in] dev Valid device object
+ * @param[in] enable True to report @ref XWII_EVENT_DRUMS_HIT events
+ *
+ * A hit is reported whenever the pressure of a drum or cymbal rises. The drum
+ * is re-armed once its pressure drops again, so holding it down does not
+ * report more hits.
+ */
+void xwii_iface_set_drum_hits(struct xwii_iface *dev, bool enable);
+
+/**
+ * Enable guitar note events
+ *
+ * @param[in] dev Valid device object
+ * @param[in] enable True to report @ref XWII_EVENT_GUITAR_NOTE events
+ *
+ * Each press of the strum bar reports the frets held at that moment, so
+ * applications do not have to rebuild chords from single key events. Frets
+ * pressed in the same report as the strum bar are included.
+ */
+void xwii_iface_set_guitar_notes(struct xwii_iface *dev, bool enable);
+
+/**
+ * Analog stick modes
+ *
+ * Modes for xwii_iface_set_stick().
+ */
+enum xwii_stick_mode {
+	/** report raw stick values (default) */
+	XWII_STICK_RAW,
+	/**
+	 * replace the stick values of MOVE events by calibrated values in
+	 * -@ref XWII_STICK_ONE..@ref XWII_STICK_ONE
+	 */
+	XWII_STICK_FIXED,
+	/**
+	 * keep MOVE events raw and report calibrated values in -1..1 via
+	 * @ref XWII_EVENT_STICK events
+	 */
+	XWII_STICK_FLOAT,
+};
+
+/** Full deflection in @ref XWII_STICK_FIXED mode */
+#define XWII_STICK_ONE 32767
+
+/**
+ * Set analog stick processing
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface @ref XWII_IFACE_NUNCHUK,
+ * @ref XWII_IFACE_CLASSIC_CONTROLLER or @ref XWII_IFACE_PRO_CONTROLLER
+ * @param[in] mode Output mode as enum xwii_stick_mode
+ * @param[in] radial Radial deadzone as fraction of the range, 0 to disable
+ * @param[in] axial Per-axis deadzone as fraction of the range, 0 to disable
+ *
+ * Sticks are calibrated on the fly: the first position is taken as center,
+ * which then slowly follows the stick while it rests, and the range of each
+ * axis grows with the largest deflection seen. Positions inside a deadzone
+ * are reported as 0, the remaining range is rescaled to reach full deflection.
+ * Only sticks are processed; classic controller triggers stay raw.
+ *
+ * Deadzones must be at least 0 and less than 1, the result of passing NaN is
+ * undefined. Calling this again restarts calibration.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments
+ */
+int xwii_iface_set_stick(struct xwii_iface *dev, unsigned int iface,
+			 unsigned int mode, float radial, float axial);
+
+/**
+ * Set MOVE event deadband
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface @ref XWII_IFACE_NUNCHUK,
+ * @ref XWII_IFACE_CLASSIC_CONTROLLER, @ref XWII_IFACE_PRO_CONTROLLER or
+ * @ref XWII_IFACE_BALANCE_BOARD
+ * @param[in] thresholds Threshold per axis, laid out like the payload of the
+ * MOVE events of @p iface
+ * @param[in] num Number of entries in @p thresholds or 0 to disable
+ *
+ * MOVE events of @p iface are only returned if some axis moved by more than
+ * its threshold since the last returned event. Reports within the deadband
+ * are dropped before any further processing, including analog stick
+ * processing and derived events, and are counted in
+ * struct xwii_iface_stats. Balance board reports are an exception: they are
+ * compared after rate limiting, see xwii_iface_set_rate(), so derived events
+ * still see all of them. Thresholds are in raw units. A negative threshold
+ * ignores an axis, as do all axes of payload entries beyond @p num. Key
+ * events are never dropped.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments
+ */
+int xwii_iface_set_deadband(struct xwii_iface *dev, unsigned int iface,
+			    const struct xwii_event_abs *thresholds,
+			    size_t num);
+
+/**
+ * Rate limit modes
+ *
+ * Modes for xwii_iface_set_rate().
+ */
+enum xwii_rate_mode {
+	/** return the newest report once per period, drop the others */
+	XWII_RATE_LATEST,
+	/** return the average of all reports of each period */
+	XWII_RATE_AVERAGE,
+};
+
+/**
+ * Limit event rate
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface @ref XWII_IFACE_ACCEL or @ref XWII_IFACE_BALANCE_BOARD
+ * @param[in] mode Decimation mode as enum xwii_rate_mode
+ * @param[in] hz Max number of events per second, at most 1000000, or 0 to
+ * disable
+ *
+ * Limits the events of @p iface returned to the application to @p hz per
+ * second, based on kernel timestamps. The limit only applies to what is
+ * returned: all derived events, fusion, gestures, swings, the history and
+ * hubs still get every report at the full rate, and unaveraged. Reports that
+ * are not returned are counted in struct xwii_iface_stats.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments
+ */
+int xwii_iface_set_rate(struct xwii_iface *dev, unsigned int iface,
+			unsigned int mode, unsigned int hz);
+
+/**
+ * Set dispatch priority of interfaces
+ *
+ * @param[in] dev Valid device object
+ * @param[in] ifaces Interfaces (single XWII_IFACE_* values) ordered from
+ * highest to lowest priority
+ * @param[in] num Number of entries in @p ifaces or 0 to restore the default
+ *
+ * If several interfaces have data pending, xwii_iface_dispatch() and
+ * xwii_iface_poll() return the events of the interface with the highest
+ * priority first. By default, the core interface goes first, then pro and
+ * classic controllers, guitar, drums and nunchuk, then the balance board,
+ * accelerometer, Motion-Plus and IR. Interfaces not listed in @p ifaces keep
+ * this order after all listed ones.
+ *
+ * Events of a single interface keep their order; keys of an extension that
+ * also reports sticks share the priority of that extension. An interface
+ * that had data pending while 4 events of other interfaces were returned is
+ * served next, so low-priority interfaces cannot starve. While frame events
+ * are enabled, interfaces are served in timestamp order instead.
+ *
+ * @returns 0 on success, -EINVAL on invalid or duplicate interfaces
+ */
+int xwii_iface_set_priority(struct xwii_iface *dev, const unsigned int *ifaces,
+			    size_t num);
+
+/**
+ * Enable frame events
+ *
+ * @param[in] dev Valid device object
+ * @param[in] enable True to report @ref XWII_EVENT_FRAME events
+ *
+ * The kernel reports the parts of a single HID report on separate interfaces
+ * with timestamps at most a few microseconds apart. If enabled, interfaces
+ * are read in timestamp order and all events of a report are merged into one
+ * frame. A frame is reported once an event of a newer report is read, or at
+ * the latest when no more events are pending, right before
+ * xwii_iface_dispatch() would return -EAGAIN. So reading events until -EAGAIN
+ * yields one frame per report, even if several reports were pending. A part
+ * read after its frame was reported is left out of frames. Single events are
+ * still reported, too. Drums are not part of frames.
+ */
+void xwii_iface_set_frames(struct xwii_iface *dev, bool enable);
+
+/**
+ * History sample
+ *
+ * A single sample stored in a history ring, see xwii_iface_set_history(). It
+ * is exactly 64 bytes, so each sample fills one cache line.
+ */
+struct xwii_history_sample {
+	/** event timestamp in microseconds */
+	uint64_t time;
+	/**
+	 * event payload; one value for accelerometer and Motion-Plus, four
+	 * for IR; unused values are zero
+	 */
+	struct xwii_event_abs abs[4];
+	/** reserved; do not use */
+	uint32_t reserved[2];
+};
+
+/**
+ * History span
+ *
+ * A contiguous range of history samples, ordered from old to new.
+ */
+struct xwii_history_span {
+	/** first sample of this span */
+	const struct xwii_history_sample *samples;
+	/** number of samples in this span; may be 0 */
+	size_t num;
+};
+
+/** Maximum number of samples of a history ring */
+#define XWII_HISTORY_MAX (1U << 20)
+
+/**
+ * Keep history of interface samples
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface @ref XWII_IFACE_ACCEL, @ref XWII_IFACE_IR or
+ * @ref XWII_IFACE_MOTION_PLUS
+ * @param[in] size Number of samples to keep, 0 to disable
+ *
+ * If enabled, the library keeps the last samples of @p iface in a ring
+ * buffer, which can be read via xwii_iface_get_history(). @p size is rounded
+ * up to the next power of two and must not exceed @ref XWII_HISTORY_MAX.
+ * Samples are stored whenever the related events are read, after rate
+ * limiting. Calling this again drops all stored samples.
+ *
+ * @returns 0 on success, -EINVAL on invalid interfaces or sizes, -ENOMEM if
+ * out of memory
+ */
+int xwii_iface_set_history(struct xwii_iface *dev, unsigned int iface,
+			   size_t size);
+
+/**
+ * Read history of interface samples
+ *
+ * @param[in] dev Valid device object
+ * @param[in] iface Interface as passed to xwii_iface_set_history()
+ * @param[in] num Maximum number of samples to return
+ * @param[out] spans Spans covering the returned samples
+ *
+ * Returns the last up to @p num samples of @p iface without copying them. The
+ * samples are ordered from old to new, starting with all samples of
+ * @p spans[0] followed by all samples of @p spans[1]. The second span is only
+ * non-empty if the samples wrap around the end of the ring. The spans point
+ * into the ring and stay valid until the next call to xwii_iface_dispatch(),
+ * xwii_iface_poll() or xwii_iface_set_history() on @p dev.
+ *
+ * @returns number of returned samples on success, -EINVAL on invalid
+ * arguments or if no history is kept for @p iface
+ */
+int xwii_iface_get_history(struct xwii_iface *dev, unsigned int iface,
+			   size_t num, struct xwii_history_span spans[2]);
+
+/** Magic of flight recorder dumps, without terminating zero */
+#define XWII_RECORDER_MAGIC "XWIIREC1"
+/** Maximum time span of the flight recorder in seconds */
+#define XWII_RECORDER_MAX_SECONDS 3600
+
+/**
+ * Flight recorder dump header
+ *
+ * A dump written by xwii_iface_dump_recorder() starts with this header,
+ * followed by @p num records of struct xwii_recorder_record ordered by time.
+ * All fields are in host byte order.
+ */
+struct xwii_recorder_header {
+	/** @ref XWII_RECORDER_MAGIC */
+	char magic[8];
+	/** timestamp of the first record in microseconds */
+	uint64_t time;
+	/** number of records */
+	uint32_t num;
+	/** recorded time span in seconds */
+	uint32_t seconds;
+};
+
+/**
+ * Flight recorder dump record
+ *
+ * A single raw input event as read from the kernel.
+ */
+struct xwii_recorder_record {
+	/** timestamp in microseconds relative to the header timestamp */
+	uint32_t time;
+	/** bit number of the XWII_IFACE_* constant of the source interface */
+	uint8_t iface;
+	/** type of the input event */
+	uint8_t type;
+	/** code of the input event */
+	uint16_t code;
+	/** value of the input event */
+	int32_t value;
+};
+
+/**
+ * Enable flight recorder
+ *
+ * @param[in] dev Valid device object
+ * @param[in] seconds Time span to keep, 0 to disable
+ *
+ * If enabled, all raw input events read from the kernel are kept in memory
+ * for at least the last @p seconds, separately for each interface, so they
+ * can be dumped via xwii_iface_dump_recorder() and replayed offline. Recording
+ * costs a single copy per input event. Calling this again drops all recorded
+ * events. @p seconds must not exceed @ref XWII_RECORDER_MAX_SECONDS.
+ *
+ * Memory is allocated for the interfaces open at this time and for each
+ * interface opened later, which fails with -ENOMEM if this is not possible.
+ *
+ * @returns 0 on success, -EINVAL if @p seconds is too big, -ENOMEM if out of
+ * memory
+ */
+int xwii_iface_set_recorder(struct xwii_iface *dev, unsigned int seconds);
+
+/**
+ * Dump flight recorder
+ *
+ * @param[in] dev Valid device object
+ * @param[in] fd File descriptor to write the dump to
+ *
+ * Writes all events recorded in the time span passed to
+ * xwii_iface_set_recorder(), relative to the newest recorded event, to @p fd.
+ * The dump is a struct xwii_recorder_header followed by its records.
+ *
+ * This function is async-signal-safe, so it can be called from a signal
+ * handler to dump on signal. If the signal interrupted the reading of events
+ * on @p dev, the last recorded event may be incomplete.
+ *
+ * @returns number of written records on success, -EINVAL if the recorder is
+ * not enabled and a negative error-code if writing fails
+ */
+int xwii_iface_dump_recorder(struct xwii_iface *dev, int fd);
+
+/** @} */
+
+/**
+ * @defgroup hub Device Hub
+ * Filter motion data of many devices at once.
+ *
+ * A hub collects the latest accelerometer, Motion-Plus and Nunchuk
+ * accelerometer samples of all its devices in a single structure-of-arrays
+ * store. xwii_hub_filter() then runs a low-pass and high-pass filter over all
+ * of them in one vectorized pass, which is much cheaper than filtering each
+ * device separately. Samples are stored whenever the related events are read
+ * via xwii_iface_dispatch() or xwii_hub_dispatch().
+ *
+ * xwii_hub_dispatch() reads events of all devices of a hub round-robin, so a
+ * single device with a large backlog cannot hold back the others.
+ *
+ * A hub and all its devices must be used from a single thread.
+ *
+ * @{
+ */
+
+/** Maximum number of devices in a hub */
+#define XWII_HUB_MAX_DEVICES 256
+
+/**
+ * Hub object
+ *
+ * Opaque object describing a hub of devices.
+ */
+struct xwii_hub;
+
+/**
+ * Hub sensors
+ *
+ * Sensors whose samples are collected by a hub.
+ */
+enum xwii_hub_sensor {
+	/** data of @ref XWII_EVENT_ACCEL */
+	XWII_HUB_ACCEL,
+	/** data of @ref XWII_EVENT_MOTION_PLUS */
+	XWII_HUB_MOTION_PLUS,
+	/** accelerometer data of @ref XWII_EVENT_NUNCHUK_MOVE */
+	XWII_HUB_NUNCHUK,
+	/** number of sensors */
+	XWII_HUB_SENSOR_NUM,
+};
+
+/**
+ * Hub sample
+ *
+ * Filtered sample of a single sensor, see xwii_hub_get().
+ */
+struct xwii_hub_sample {
+	/** latest x, y and z values as reported by the event */
+	float raw[3];
+	/** low-pass filtered values */
+	float low[3];
+	/** high-pass filtered values, that is raw minus low */
+	float high[3];
+};
+
+/**
+ * Create a new hub
+ *
+ * @param[out] hub Pointer where to store the new hub
+ * @param[in] size Maximum number of devices, at most
+ * @ref XWII_HUB_MAX_DEVICES
+ *
+ * Creates a new hub with a ref-count of 1.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_hub_new(struct xwii_hub **hub, unsigned int size);
+
+/**
+ * Increase hub ref-count by 1
+ *
+ * @param[in] hub Valid hub object
+ */
+void xwii_hub_ref(struct xwii_hub *hub);
+
+/**
+ * Decrease hub ref-count by 1
+ *
+ * @param[in] hub Valid hub object
+ *
+ * If the ref-count drops below 1, all devices are removed and the hub is
+ * destroyed.
+ */
+void xwii_hub_unref(struct xwii_hub *hub);
+
+/**
+ * Add device to hub
+ *
+ * @param[in] hub Valid hub object
+ * @param[in] dev Valid device object
+ *
+ * Adds @p dev to the first free slot of @p hub. The hub takes a reference
+ * to the device until it is removed. A device can only be part of one hub.
+ *
+ * @returns slot index on success, -ENOSPC if the hub is full, -EBUSY if the
+ * device belongs to another hub and a negative error code on failure
+ */
+int xwii_hub_add(struct xwii_hub *hub, struct xwii_iface *dev);
+
+/**
+ * Remove device from hub
+ *
+ * @param[in] hub Valid hub object
+ * @param[in] dev Device to remove
+ *
+ * Removes @p dev from @p hub and drops the reference taken by xwii_hub_add().
+ * Does nothing if @p dev is not part of @p hub.
+ */
+void xwii_hub_remove(struct xwii_hub *hub, struct xwii_iface *dev);
+
+/**
+ * Set hub filter
+ *
+ * @param[in] hub Valid hub object
+ * @param[in] sensor Sensor as enum xwii_hub_sensor
+ * @param[in] alpha Low-pass smoothing factor per filter pass
+ *
+ * Each xwii_hub_filter() pass moves the low-pass output of @p sensor towards
+ * the latest sample by @p alpha, which must be greater than 0 and at most 1,
+ * the result of passing NaN is undefined. Smaller values smooth more. The
+ * default is 0.2 for all sensors.
+ *
+ * @returns 0 on success, negative error code on failure
+ */
+int xwii_hub_set_filter(struct xwii_hub *hub, unsigned int sensor,
+			float alpha);
+
+/**
+ * Run hub filters
+ *
+ * @param[in] hub Valid hub object
+ *
+ * Runs one filter pass over the latest samples of all devices and sensors.
+ * Call this once per frame of your application.
+ */
+void xwii_hub_filter(struct xwii_hub *hub);
+
+/**
+ * Read filtered sample
+ *
+ * @param[in] hub Valid hub object
+ * @param[in] slot Slot as returned by xwii_hub_add()
+ * @param[in] sensor Sensor as enum xwii_hub_sensor
+ * @param[out] sample Pointer where to store the sample
+ *
+ * @returns 0 on success, -EAGAIN if no sample of @p sensor was received for
+ * this slot, yet, and a negative error code on failure
+ */
+int xwii_hub_get(struct xwii_hub *hub, unsigned int slot,
+		 unsigned int sensor, struct xwii_hub_sample *sample);
+
+/**
+ * Return hub file descriptor
+ *
+ * @param[in] hub Valid hub object
+ *
+ * Returns a file descriptor which is readable whenever any device of @p hub
+ * has data pending. Watch it for POLLIN and call xwii_hub_dispatch() until it
+ * returns -EAGAIN.
+ *
+ * @returns file descriptor or -1 if @p hub is invalid
+ */
+int xwii_hub_get_fd(struct xwii_hub *hub);
+
+/**
+ * Set round-robin quantum
+ *
+ * @param[in] hub Valid hub object
+ * @param[in] quantum Max events per device and turn, at least 1
+ *
+ * xwii_hub_dispatch() returns at most @p quantum events of a device in a row
+ * before it moves on to the next device with data pending. The default is 4.
+ *
+ * @returns 0 on success, -EINVAL on invalid arguments
+ */
+int xwii_hub_set_quantum(struct xwii_hub *hub, unsigned int quantum);
+
+/**
+ * Read event of any hub device
+ *
+ * @param[in] hub Valid hub object
+ * @param[out] slot Pointer where to store the slot of the device
+ * @param[out] ev Pointer where to store the event
+ * @param[in] size Size of @p ev, see xwii_iface_dispatch()
+ *
+ * Like xwii_iface_dispatch(), but serves all devices of @p hub round-robin.
+ * Once a device returned its quantum of events, or has nothing pending, the
+ * next device is served. The slot of the device the event belongs to is
+ * stored in @p slot. If a device returns an error, it is passed through with
+ * @p slot set, too.
+ *
+ * @returns 0 on success, -EAGAIN if no device has events pending and a
+ * negative error code on failure
+ */
+int xwii_hub_dispatch(struct xwii_hub *hub, unsigned int *slot,
+		      struct xwii_event *ev, size_t size);
+
+/** @} */
+
+/**
+ * @defgroup monitor Device Monitor
+ * Monitor system for new wiimote devices.
+ *
+ * This monitor can be used to enumerate all connected wiimote devices and also
+ * monitoring the system for hotplugged wiimote devices.
+ * This is a simple wrapper around libudev and should only be used if your
+ * application does not use udev on its own.
+ * See the implementation of the monitor to integrate wiimote-monitoring into
+ * your own udev routines.
+ *
+ * If the library was built without libudev, the monitor enumerates
+ * /sys/bus/hid/drivers/wiimote/ directly and listens for raw kernel uevents.
+ * No udev daemon is required in that case.
+ *
+ * @{
+ */
+
+/**
+ * Monitor object
+ *
+ * Each object describes a separate monitor. A single monitor must not be
+ * used from multiple threads without locking. Different monitors are
+ * independent of each other and can be used simultaneously.
+ */
+struct xwii_monitor;
+
+/**
+ * Create a new monitor
+ *
+ * Creates a new monitor and returns a pointer to the opaque object. NULL is
+ * returned on failure.
+ *
+ * @param[in] poll True if this monitor should watch for hotplug events
+ * @param[in] direct True if kernel uevents should be used instead of udevd
+ *
+ * A monitor always provides all devices that are available on a system. If
+ * @p poll is true, the monitor also sets up a system-monitor to watch the
+ * system for new hotplug events so new devices can be detected.
+ *
+ * If the library was built without libudev, kernel uevents are always used
+ * and @p direct has no effect.
  *
  * A new monitor always has a ref-count of 1.
  */
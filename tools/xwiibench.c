@@ -0,0 +1,1272 @@
+/*
+ * XWiimote - tools - xwiibench
+ * Written 2010-2013 by David Herrmann
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * Library Benchmarks
+ * Each benchmark is selected by its name as first argument and prints its
+ * results to stdout. Benchmarks that need devices use all connected Wii
+ * Remotes, or simulated ones if none is connected, the others run on
+ * synthetic data and need no hardware at all.
+ * Timings are taken with CLOCK_MONOTONIC; run them on an otherwise idle
+ * machine.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <linux/input.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "drums.h"
+#include "filter.h"
+#include "fusion.h"
+#include "gesture.h"
+#include "xwiimote.h"
+
+/* max number of device paths used by device benchmarks */
+#define BENCH_MAX_DEVS 256
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long arg_num(int argc, char **argv, int i, unsigned long def)
+{
+	if (i >= argc)
+		return def;
+
+	return strtoul(argv[i], NULL, 10);
+}
+
+/*
+ * Collect the syspaths of all connected devices into \paths and repeat them
+ * until \num entries are filled; returns the number of distinct devices.
+ */
+static size_t collect_devs(char **paths, size_t num)
+{
+	struct xwii_monitor *mon;
+	char *ent;
+	size_t n = 0, i;
+
+	mon = xwii_monitor_new(false, false);
+	if (!mon) {
+		fprintf(stderr, "Cannot create monitor\n");
+		return 0;
+	}
+
+	while (n < num && (ent = xwii_monitor_poll(mon)))
+		paths[n++] = ent;
+
+	xwii_monitor_unref(mon);
+
+	for (i = n; n && i < num; ++i)
+		paths[i] = paths[i % n];
+
+	return n;
+}
+
+/* set timestamp of \ev to \us microseconds */
+static void set_time(struct xwii_event *ev, uint64_t us)
+{
+	ev->time.tv_sec = us / 1000000;
+	ev->time.tv_usec = us % 1000000;
+}
+
+static void free_devs(char **paths, size_t real)
+{
+	size_t i;
+
+	for (i = 0; i < real; ++i)
+		free(paths[i]);
+}
+
+/*
+ * Fake sysfs tree
+ * Device benchmarks run on simulated devices if no device is connected. A
+ * fake tree with the layout of /sys is created below /tmp and the library is
+ * pointed to it via XWII_SYSFS_ROOT. Device nodes are FIFOs in its dev/
+ * directory, so benchmarks can feed them input events. Only the sysfs backend
+ * of the library (--disable-udev) supports this, libudev insists on /sys.
+ */
+static char fake_root[PATH_MAX];
+
+static const struct {
+	unsigned int iface;
+	const char *name;
+} fake_names[] = {
+	{ XWII_IFACE_CORE, XWII_NAME_CORE },
+	{ XWII_IFACE_ACCEL, XWII_NAME_ACCEL },
+	{ XWII_IFACE_IR, XWII_NAME_IR },
+	{ XWII_IFACE_MOTION_PLUS, XWII_NAME_MOTION_PLUS },
+	{ XWII_IFACE_NUNCHUK, XWII_NAME_NUNCHUK },
+};
+
+enum fake_type {
+	FAKE_DIR,
+	FAKE_FILE,
+	FAKE_LINK,
+	FAKE_FIFO,
+};
+
+/*
+ * create directory, file with content \data, symlink to \data or FIFO at the
+ * path \fmt relative to the fake root
+ */
+static int fake_mk(unsigned int type, const char *data, const char *fmt, ...)
+{
+	char rel[PATH_MAX], path[PATH_MAX];
+	va_list args;
+	size_t len;
+	FILE *f;
+	int r;
+
+	va_start(args, fmt);
+	r = vsnprintf(rel, sizeof(rel), fmt, args);
+	va_end(args);
+	len = strlen(fake_root);
+	if (r < 0 || len + 1 + r >= sizeof(path))
+		return -ENAMETOOLONG;
+
+	memcpy(path, fake_root, len);
+	path[len] = '/';
+	memcpy(&path[len + 1], rel, r + 1);
+
+	switch (type) {
+	case FAKE_DIR:
+		return mkdir(path, 0755) ? -errno : 0;
+	case FAKE_LINK:
+		return symlink(data, path) ? -errno : 0;
+	case FAKE_FIFO:
+		return mkfifo(path, 0600) ? -errno : 0;
+	}
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	fputs(data, f);
+	fclose(f);
+	return 0;
+}
+
+/* create fake device \idx with the interfaces in \ifaces */
+static int fake_dev(unsigned int idx, unsigned int ifaces)
+{
+	char dev[64], buf[80];
+	unsigned int i, ev;
+	int ret;
+
+	snprintf(dev, sizeof(dev), "devices/0005:057E:0306.%04X", idx);
+	snprintf(buf, sizeof(buf), "../../../../%s", dev);
+	ret = fake_mk(FAKE_DIR, NULL, "%s", dev);
+	if (!ret)
+		ret = fake_mk(FAKE_LINK, buf, "bus/hid/drivers/wiimote/%s",
+			      strchr(dev, '/') + 1);
+	if (!ret)
+		ret = fake_mk(FAKE_LINK, "../../bus/hid/drivers/wiimote",
+			      "%s/driver", dev);
+	if (!ret)
+		ret = fake_mk(FAKE_LINK, "../../bus/hid", "%s/subsystem", dev);
+	if (!ret)
+		ret = fake_mk(FAKE_DIR, NULL, "%s/input", dev);
+
+	for (i = 0; !ret && i < sizeof(fake_names) / sizeof(*fake_names);
+	     ++i) {
+		if (!(ifaces & fake_names[i].iface))
+			continue;
+
+		ev = idx * 16 + i;
+		snprintf(buf, sizeof(buf), "DEVNAME=input/event%u\n", ev);
+		ret = fake_mk(FAKE_DIR, NULL, "%s/input/input%u", dev, ev);
+		if (!ret)
+			ret = fake_mk(FAKE_FILE, fake_names[i].name,
+				      "%s/input/input%u/name", dev, ev);
+		if (!ret)
+			ret = fake_mk(FAKE_DIR, NULL,
+				      "%s/input/input%u/event%u", dev, ev, ev);
+		if (!ret)
+			ret = fake_mk(FAKE_FILE, buf,
+				      "%s/input/input%u/event%u/uevent", dev,
+				      ev, ev);
+		if (!ret)
+			ret = fake_mk(FAKE_FIFO, NULL, "dev/input/event%u",
+				      ev);
+	}
+
+	return ret;
+}
+
+static int fake_remove(const char *path, const struct stat *st, int flag,
+		       struct FTW *ftw)
+{
+	return remove(path);
+}
+
+static void fake_free(void)
+{
+	if (!fake_root[0])
+		return;
+
+	nftw(fake_root, fake_remove, 16, FTW_DEPTH | FTW_PHYS);
+	fake_root[0] = 0;
+	unsetenv("XWII_SYSFS_ROOT");
+}
+
+/* create a fake tree of \num devices with the interfaces in \ifaces */
+static int fake_tree(size_t num, unsigned int ifaces)
+{
+	static const char *const dirs[] = {
+		"devices", "bus", "bus/hid", "bus/hid/drivers",
+		"bus/hid/drivers/wiimote", "dev", "dev/input",
+	};
+	char tmpl[] = "/tmp/xwiibench-XXXXXX";
+	unsigned int i;
+	int ret;
+
+#ifdef HAVE_UDEV
+	fprintf(stderr, "Simulated devices need the sysfs backend, "
+		"configure with --disable-udev\n");
+	return -ENOTSUP;
+#endif
+
+	/* the library compares canonical paths against the root */
+	if (!mkdtemp(tmpl) || !realpath(tmpl, fake_root))
+		return -errno;
+
+	for (i = 0; i < sizeof(dirs) / sizeof(*dirs); ++i) {
+		ret = fake_mk(FAKE_DIR, NULL, "%s", dirs[i]);
+		if (ret)
+			goto err;
+	}
+
+	for (i = 0; i < num; ++i) {
+		ret = fake_dev(i, ifaces);
+		if (ret)
+			goto err;
+	}
+
+	setenv("XWII_SYSFS_ROOT", fake_root, 1);
+	return 0;
+
+err:
+	fake_free();
+	return ret;
+}
+
+/* construct objects for \num paths; \mode 0 is eager, 1 lazy, 2 new_many */
+static int new_round(struct xwii_iface **devs, int *errs, char **paths,
+		     size_t num, unsigned int mode)
+{
+	size_t i;
+
+	if (mode == 2)
+		return xwii_iface_new_many(devs, errs,
+					   (const char *const *)paths, num,
+					   0, 0);
+
+	for (i = 0; i < num; ++i) {
+		errs[i] = xwii_iface_new_flags(&devs[i], paths[i],
+					       mode ? XWII_NEW_LAZY : 0);
+		if (errs[i])
+			devs[i] = NULL;
+	}
+
+	return 0;
+}
+
+/*
+ * new: construction time of device objects
+ * Constructs an object for each of \num device paths, eagerly, lazily via
+ * XWII_NEW_LAZY and concurrently via xwii_iface_new_many(). If fewer devices
+ * are connected, they are used repeatedly, which is what reconnecting a room
+ * of remotes looks like to the library.
+ */
+static int bench_new(int argc, char **argv)
+{
+	static const char *const names[] = { "eager", "lazy", "new_many" };
+	char *paths[BENCH_MAX_DEVS];
+	struct xwii_iface *devs[BENCH_MAX_DEVS];
+	int errs[BENCH_MAX_DEVS];
+	size_t num, real, i;
+	unsigned long rounds, r;
+	uint64_t start, total[3] = { 0, 0, 0 };
+	unsigned int m;
+	int ret;
+
+	num = arg_num(argc, argv, 2, 16);
+	rounds = arg_num(argc, argv, 3, 10);
+	if (!num || num > BENCH_MAX_DEVS || !rounds) {
+		fprintf(stderr, "Invalid device or round count\n");
+		return -EINVAL;
+	}
+
+	real = collect_devs(paths, num);
+	if (!real) {
+		ret = fake_tree(num, XWII_IFACE_CORE | XWII_IFACE_ACCEL |
+				     XWII_IFACE_IR);
+		if (ret) {
+			fprintf(stderr, "Cannot simulate devices: %d\n", ret);
+			return ret;
+		}
+		real = collect_devs(paths, num);
+		if (real != num) {
+			fprintf(stderr, "Cannot find simulated devices\n");
+			ret = -ENODEV;
+			goto err;
+		}
+	}
+
+	for (r = 0; r < rounds; ++r) {
+		for (m = 0; m < 3; ++m) {
+			start = now_ns();
+			ret = new_round(devs, errs, paths, num, m);
+			total[m] += now_ns() - start;
+			if (ret < 0)
+				goto err;
+
+			ret = 0;
+			for (i = 0; i < num; ++i) {
+				if (devs[i])
+					xwii_iface_unref(devs[i]);
+				else if (!ret)
+					ret = errs[i];
+			}
+			if (ret)
+				goto err;
+		}
+	}
+
+	printf("%zu objects (%zu %s devices), %lu rounds\n", num, real,
+	       fake_root[0] ? "simulated" : "connected", rounds);
+	for (m = 0; m < 3; ++m)
+		printf("  %-8s %10.1f us per object\n", names[m],
+		       total[m] / 1000.0 / rounds / num);
+
+	free_devs(paths, real);
+	fake_free();
+	return 0;
+
+err:
+	fprintf(stderr, "Cannot create device object: %d\n", ret);
+	free_devs(paths, real);
+	fake_free();
+	return ret;
+}
+
+/* number of distinct samples of synthetic motion streams */
+#define BENCH_SAMPLES 1000
+
+/*
+ * fusion: orientation fusion throughput
+ * Runs the fusion stage on a synthetic 100 Hz stream of a remote that slowly
+ * rotates about all axes, once per kernel. Every update pairs a gyro sample
+ * with an accelerometer sample, like a device reporting both.
+ */
+static int bench_fusion(int argc, char **argv)
+{
+	static const char *const names[] = { "float", "fixed" };
+	static const unsigned int modes[] = {
+		XWII_FUSION_FLOAT,
+		XWII_FUSION_FIXED,
+	};
+	static struct xwii_event accel[BENCH_SAMPLES], gyro[BENCH_SAMPLES];
+	struct xwii__fusion f;
+	struct xwii_event out;
+	unsigned long num, i;
+	uint64_t ns;
+	double sum = 0.0;
+	unsigned int m, k;
+	float t;
+
+	num = arg_num(argc, argv, 2, 1000000);
+	if (!num) {
+		fprintf(stderr, "Invalid update count\n");
+		return -EINVAL;
+	}
+
+	for (k = 0; k < BENCH_SAMPLES; ++k) {
+		t = k * 0.01f;
+		accel[k].type = XWII_EVENT_ACCEL;
+		accel[k].v.abs[0].x = 100.0f * sinf(t);
+		accel[k].v.abs[0].y = 10.0f * cosf(t);
+		accel[k].v.abs[0].z = 100.0f * cosf(t);
+		gyro[k].type = XWII_EVENT_MOTION_PLUS;
+		gyro[k].v.abs[0].x = 7105.0f * cosf(t);
+		gyro[k].v.abs[0].y = 3000.0f * sinf(t);
+		gyro[k].v.abs[0].z = 500.0f;
+	}
+
+	printf("%lu updates\n", num);
+	for (m = 0; m < 2; ++m) {
+		xwii__fusion_init(&f, modes[m], 0.5f);
+		ns = now_ns();
+		for (i = 0; i < num; ++i) {
+			k = i % BENCH_SAMPLES;
+			set_time(&accel[k], 1000000 + i * 10000ULL);
+			gyro[k].time = accel[k].time;
+			xwii__fusion_accel(&f, &accel[k]);
+			if (xwii__fusion_gyro(&f, &gyro[k], &out))
+				sum += out.v.orientation.quat[0];
+		}
+		ns = now_ns() - ns;
+
+		printf("  %-6s %8.1f ns per update, %8.2f M updates/s\n",
+		       names[m], (double)ns / num, num * 1000.0 / ns);
+	}
+
+	/* print the result so the filter cannot be optimized away */
+	printf("  checksum %f\n", sum);
+	return 0;
+}
+
+/* deterministic pseudo random numbers in [-1, 1] */
+static float bench_rand(void)
+{
+	static uint32_t state = 1;
+
+	state = state * 1103515245 + 12345;
+	return (state >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+/* one coordinate over time with its true value, if known */
+struct trace {
+	size_t num;
+	int64_t *time;
+	float *x;
+	float *truth;
+};
+
+static void trace_free(struct trace *t)
+{
+	free(t->time);
+	free(t->x);
+	free(t->truth);
+	memset(t, 0, sizeof(*t));
+}
+
+static int trace_alloc(struct trace *t, size_t num)
+{
+	t->num = num;
+	t->time = calloc(num, sizeof(*t->time));
+	t->x = calloc(num, sizeof(*t->x));
+	t->truth = calloc(num, sizeof(*t->truth));
+	if (!t->time || !t->x || !t->truth) {
+		trace_free(t);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * Synthetic IR trace: 20s at 100 Hz of a dot that rests for a second, then
+ * jumps 300 pixels within 300ms on a minimum-jerk curve, with 2 pixels of
+ * sensor noise.
+ */
+static int trace_synthetic(struct trace *t)
+{
+	unsigned int i;
+	float phase, from, to, a;
+	int ret;
+
+	ret = trace_alloc(t, 2000);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < t->num; ++i) {
+		phase = (i % 130) / 30.0f;
+		from = (i / 130) % 2 ? 662.0f : 362.0f;
+		to = (i / 130) % 2 ? 362.0f : 662.0f;
+		if (phase < 1.0f)
+			a = phase * phase * phase *
+			    (10.0f - 15.0f * phase + 6.0f * phase * phase);
+		else
+			a = 1.0f;
+
+		t->time[i] = 1000000 + i * 10000LL;
+		t->truth[i] = from + (to - from) * a;
+		t->x[i] = t->truth[i] + bench_rand() + bench_rand();
+	}
+
+	return 0;
+}
+
+/*
+ * IR trace of slot 0 of flight recorder dump \file. The truth is unknown, so
+ * a centered moving average, which has no lag, is used instead.
+ */
+static int trace_dump(struct trace *t, const char *file)
+{
+	struct xwii_recorder_header hdr;
+	struct xwii_recorder_record rec;
+	unsigned int ir = __builtin_ctz(XWII_IFACE_IR);
+	int32_t x = 1023, y = 1023;
+	size_t i, k, n = 0;
+	FILE *in;
+	float sum;
+	int ret;
+
+	in = fopen(file, "rb");
+	if (!in) {
+		fprintf(stderr, "Cannot open %s: %d\n", file, errno);
+		return -errno;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+	    memcmp(hdr.magic, XWII_RECORDER_MAGIC, sizeof(hdr.magic))) {
+		fprintf(stderr, "Invalid flight recorder dump %s\n", file);
+		fclose(in);
+		return -EINVAL;
+	}
+
+	ret = trace_alloc(t, hdr.num ? hdr.num : 1);
+	if (ret) {
+		fclose(in);
+		return ret;
+	}
+
+	while (fread(&rec, sizeof(rec), 1, in) == 1) {
+		if (rec.iface != ir)
+			continue;
+		if (rec.type == EV_ABS && rec.code == ABS_HAT0X)
+			x = rec.value;
+		else if (rec.type == EV_ABS && rec.code == ABS_HAT0Y)
+			y = rec.value;
+		else if (rec.type != EV_SYN || n >= t->num)
+			continue;
+		else if (x != 1023 || y != 1023) {
+			t->time[n] = hdr.time + rec.time;
+			t->x[n++] = x;
+		}
+	}
+	fclose(in);
+
+	t->num = n;
+	for (i = 0; i < n; ++i) {
+		sum = 0.0f;
+		for (k = i < 4 ? 0 : i - 4; k <= i + 4 && k < n; ++k)
+			sum += t->x[k];
+		t->truth[i] = sum / (k - (i < 4 ? 0 : i - 4));
+	}
+
+	return n ? 0 : -ENODATA;
+}
+
+/*
+ * smoothing: latency and jitter of IR filters
+ * Jitter is the RMS error while the truth rests. Lag is the mean error while
+ * it moves divided by its mean speed, that is, how far the output trails.
+ */
+static int bench_smoothing(int argc, char **argv)
+{
+	static const char *const names[] = {
+		"none", "one-euro", "kalman", "average-5",
+	};
+	static const unsigned int types[] = {
+		XWII_FILTER_NONE,
+		XWII_FILTER_ONE_EURO,
+		XWII_FILTER_KALMAN,
+		XWII_FILTER_NONE,
+	};
+	struct xwii__filter_params params;
+	struct xwii__filter f;
+	struct trace t;
+	double rest, rest_num, err, speed, move_num, dt;
+	float out, hist[5], v;
+	unsigned int m, k;
+	size_t i;
+	int ret;
+
+	memset(&t, 0, sizeof(t));
+	if (argc > 2)
+		ret = trace_dump(&t, argv[2]);
+	else
+		ret = trace_synthetic(&t);
+	if (ret) {
+		fprintf(stderr, "Cannot load trace: %d\n", ret);
+		trace_free(&t);
+		return ret;
+	}
+
+	printf("%zu samples of %s\n", t.num, argc > 2 ? argv[2] :
+					    "synthetic data");
+	printf("  %-10s %12s %10s\n", "filter", "jitter (px)", "lag (ms)");
+	for (m = 0; m < 4; ++m) {
+		xwii__filter_setup(&params, types[m], 0.0f, 0.0f, 0.0f);
+		xwii__filter_reset(&f);
+		rest = rest_num = err = speed = move_num = 0.0;
+
+		for (i = 0; i < t.num; ++i) {
+			if (m == 3) {
+				/* what applications do without the library */
+				hist[i % 5] = t.x[i];
+				out = 0.0f;
+				for (k = 0; k < 5; ++k)
+					out += hist[k <= i ? k : i % 5];
+				out /= 5;
+			} else if (params.type) {
+				out = xwii__filter_update(&f, &params, t.x[i],
+							  t.time[i]);
+			} else {
+				out = t.x[i];
+			}
+
+			if (!i)
+				continue;
+
+			dt = (t.time[i] - t.time[i - 1]) * 1e-6;
+			v = dt > 0 ? fabs(t.truth[i] - t.truth[i - 1]) / dt : 0;
+			if (v < 20.0f) {
+				rest += (out - t.truth[i]) * (out - t.truth[i]);
+				++rest_num;
+			} else {
+				err += fabs(out - t.truth[i]);
+				speed += v;
+				++move_num;
+			}
+		}
+
+		printf("  %-10s %12.2f %10.1f\n", names[m],
+		       rest_num ? sqrt(rest / rest_num) : 0.0,
+		       speed ? err / speed * 1000.0 : 0.0);
+	}
+
+	trace_free(&t);
+	return 0;
+}
+
+/* filter state of one device as kept without a hub */
+struct hub_dev {
+	float in[XWII_HUB_SENSOR_NUM][3];
+	float low[XWII_HUB_SENSOR_NUM][3];
+	float high[XWII_HUB_SENSOR_NUM][3];
+};
+
+__attribute__((noinline))
+static void hub_dev_filter(struct hub_dev *d, float alpha)
+{
+	unsigned int s, a;
+
+	for (s = 0; s < XWII_HUB_SENSOR_NUM; ++s) {
+		for (a = 0; a < 3; ++a) {
+			d->low[s][a] += alpha * (d->in[s][a] - d->low[s][a]);
+			d->high[s][a] = d->in[s][a] - d->low[s][a];
+		}
+	}
+}
+
+/*
+ * hub: one xwii_hub_filter() pass over all devices against filtering each
+ * device on its own. Samples can only be stored in a hub by member devices,
+ * so its store stays zeroed; the kernels do not depend on the values.
+ */
+static int bench_hub(int argc, char **argv)
+{
+	struct xwii_hub *hub;
+	struct hub_dev *devs;
+	unsigned long num, i;
+	unsigned int size, k, s, a;
+	uint64_t ns_hub, ns_dev;
+	double sum = 0.0;
+	int ret;
+
+	size = arg_num(argc, argv, 2, 16);
+	num = arg_num(argc, argv, 3, 1000000);
+	if (!size || size > XWII_HUB_MAX_DEVICES || !num) {
+		fprintf(stderr, "Invalid device or pass count\n");
+		return -EINVAL;
+	}
+
+	ret = xwii_hub_new(&hub, size);
+	if (ret) {
+		fprintf(stderr, "Cannot create hub: %d\n", ret);
+		return ret;
+	}
+
+	devs = calloc(size, sizeof(*devs));
+	if (!devs) {
+		xwii_hub_unref(hub);
+		return -ENOMEM;
+	}
+
+	for (k = 0; k < size; ++k)
+		for (s = 0; s < XWII_HUB_SENSOR_NUM; ++s)
+			for (a = 0; a < 3; ++a)
+				devs[k].in[s][a] = bench_rand() * 100.0f;
+
+	ns_hub = now_ns();
+	for (i = 0; i < num; ++i)
+		xwii_hub_filter(hub);
+	ns_hub = now_ns() - ns_hub;
+
+	ns_dev = now_ns();
+	for (i = 0; i < num; ++i)
+		for (k = 0; k < size; ++k)
+			hub_dev_filter(&devs[k], 0.2f);
+	ns_dev = now_ns() - ns_dev;
+
+	for (k = 0; k < size; ++k)
+		sum += devs[k].high[0][0];
+
+	printf("%u devices, %lu passes\n", size, num);
+	printf("  %-10s %8.1f ns per pass\n", "hub", (double)ns_hub / num);
+	printf("  %-10s %8.1f ns per pass\n", "per-device",
+	       (double)ns_dev / num);
+	printf("  speedup %.2fx, checksum %f\n",
+	       ns_hub ? (double)ns_dev / ns_hub : 0.0, sum);
+
+	free(devs);
+	xwii_hub_unref(hub);
+	return 0;
+}
+
+/* sample \i of synthetic gesture \id; accelerometer units, 1g is about 100 */
+static void gesture_sample(struct xwii_event_abs *v, unsigned int id,
+			   unsigned int i, unsigned int len)
+{
+	float t = 2.0f * M_PI * i / len;
+
+	v->x = 120.0f * sinf(t * (1 + id % 3) + id);
+	v->y = 80.0f * cosf(t * (1 + id % 2) - id * 0.5f);
+	v->z = 100.0f + 60.0f * sinf(t + id * 0.25f);
+}
+
+/*
+ * gesture: template matching load of many remotes at 100 Hz
+ * Each remote rests with sensor noise and performs one of the templates,
+ * with noise, every 2 seconds. Reported is the time per accelerometer sample
+ * and the share of one core needed to keep up in real time.
+ */
+static int bench_gesture(int argc, char **argv)
+{
+	struct xwii_event_abs tmpl[XWII__GESTURE_MAX_LEN], v;
+	struct xwii__gesture **g;
+	struct xwii_event ev, out;
+	unsigned int num, remotes, k, r, len, id, i, matches = 0, hits = 0;
+	unsigned int seconds = 60, rate = 100, n;
+	uint64_t ns = 0, t;
+	int ret = 0;
+
+	num = arg_num(argc, argv, 2, XWII__GESTURE_MAX);
+	remotes = arg_num(argc, argv, 3, 16);
+	if (!num || num > XWII__GESTURE_MAX || !remotes ||
+	    remotes > BENCH_MAX_DEVS) {
+		fprintf(stderr, "Invalid template or remote count\n");
+		return -EINVAL;
+	}
+
+	g = calloc(remotes, sizeof(*g));
+	if (!g)
+		return -ENOMEM;
+
+	for (r = 0; r < remotes; ++r) {
+		g[r] = xwii__gesture_new();
+		if (!g[r]) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		for (k = 0; k < num; ++k) {
+			len = 24 + k * 37 % (XWII__GESTURE_MAX_LEN - 24);
+			for (i = 0; i < len; ++i)
+				gesture_sample(&tmpl[i], k, i, len);
+			ret = xwii__gesture_add(g[r], k, XWII__GESTURE_ACCEL,
+						tmpl, len, 400.0f);
+			if (ret) {
+				fprintf(stderr, "Cannot add template: %d\n",
+					ret);
+				goto out;
+			}
+		}
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = XWII_EVENT_ACCEL;
+	for (n = 0; n < seconds * rate; ++n) {
+		set_time(&ev, 1000000 + n * 10000ULL);
+		for (r = 0; r < remotes; ++r) {
+			/* remotes start their gestures at different times */
+			i = (n + r * 13) % (2 * rate);
+			id = ((n + r * 13) / (2 * rate) + r) % num;
+			len = 24 + id * 37 % (XWII__GESTURE_MAX_LEN - 24);
+			if (i < len) {
+				gesture_sample(&v, id, i, len);
+				if (i == len - 1)
+					++hits;
+			} else {
+				v.x = 0.0f;
+				v.y = 0.0f;
+				v.z = 100.0f;
+			}
+			v.x += 4.0f * bench_rand();
+			v.y += 4.0f * bench_rand();
+			v.z += 4.0f * bench_rand();
+
+			t = now_ns();
+			if (xwii__gesture_feed(g[r], XWII__GESTURE_ACCEL, &ev,
+					       &v, &out))
+				++matches;
+			ns += now_ns() - t;
+		}
+	}
+
+	n *= remotes;
+	printf("%u templates, %u remotes, %u s at %u Hz\n", num, remotes,
+	       seconds, rate);
+	printf("  %8.2f us per sample, %5.2f %% of one core\n",
+	       ns / 1000.0 / n, ns / 1e7 / seconds);
+	printf("  %u matches for %u performed gestures\n", matches, hits);
+
+out:
+	for (r = 0; r < remotes; ++r)
+		xwii__gesture_free(g[r]);
+	free(g);
+	return ret;
+}
+
+/*
+ * Synthetic drums session: 120s of reports at 100 Hz. Each drum is hit at
+ * random intervals; its pressure rises within one or two reports and then
+ * decays. Returns the number of reports in \out.
+ */
+static size_t drums_synthetic(struct xwii_event *out, size_t max)
+{
+	static const unsigned int prof[2][4] = {
+		{ 2, 4, 2, 0 },
+		{ 4, 2, 0, 0 },
+	};
+	unsigned int next[XWII_DRUMS_ABS_NUM] = { 0 };
+	unsigned int kind[XWII_DRUMS_ABS_NUM] = { 0 };
+	unsigned int peak[XWII_DRUMS_ABS_NUM] = { 0 };
+	unsigned int age[XWII_DRUMS_ABS_NUM] = { 0 };
+	unsigned int i;
+	size_t n;
+
+	for (n = 0; n < max && n < 12000; ++n) {
+		memset(&out[n], 0, sizeof(out[n]));
+		out[n].type = XWII_EVENT_DRUMS_MOVE;
+		set_time(&out[n], 1000000 + n * 10000ULL);
+		for (i = XWII_DRUMS_ABS_CYMBAL_LEFT; i < XWII_DRUMS_ABS_NUM;
+		     ++i) {
+			if (n >= next[i]) {
+				next[i] = n + 20 + (bench_rand() + 1.0f) * 40;
+				kind[i] = bench_rand() > 0.0f;
+				peak[i] = 2 + (bench_rand() + 1.0f) * 2.5f;
+				age[i] = 0;
+			}
+			if (age[i] < 4)
+				out[n].v.abs[i].x = prof[kind[i]][age[i]++] *
+						    peak[i] / 4;
+		}
+	}
+
+	return n;
+}
+
+/* drums reports of flight recorder dump \file; returns their number */
+static ssize_t drums_dump(const char *file, struct xwii_event *out,
+			  size_t max)
+{
+	/* ABS codes of the drums, which older kernel headers lack */
+	static const struct {
+		unsigned int code;
+		unsigned int idx;
+	} map[] = {
+		{ 0x45, XWII_DRUMS_ABS_CYMBAL_LEFT },
+		{ 0x46, XWII_DRUMS_ABS_CYMBAL_RIGHT },
+		{ 0x41, XWII_DRUMS_ABS_TOM_LEFT },
+		{ 0x42, XWII_DRUMS_ABS_TOM_RIGHT },
+		{ 0x43, XWII_DRUMS_ABS_TOM_FAR_RIGHT },
+		{ 0x48, XWII_DRUMS_ABS_BASS },
+		{ 0x49, XWII_DRUMS_ABS_HI_HAT },
+	};
+	struct xwii_recorder_header hdr;
+	struct xwii_recorder_record rec;
+	struct xwii_event_abs cache[XWII_DRUMS_ABS_NUM];
+	unsigned int drums = __builtin_ctz(XWII_IFACE_DRUMS), i;
+	size_t n = 0;
+	FILE *in;
+
+	in = fopen(file, "rb");
+	if (!in) {
+		fprintf(stderr, "Cannot open %s: %d\n", file, errno);
+		return -errno;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+	    memcmp(hdr.magic, XWII_RECORDER_MAGIC, sizeof(hdr.magic))) {
+		fprintf(stderr, "Invalid flight recorder dump %s\n", file);
+		fclose(in);
+		return -EINVAL;
+	}
+
+	memset(cache, 0, sizeof(cache));
+	while (n < max && fread(&rec, sizeof(rec), 1, in) == 1) {
+		if (rec.iface != drums)
+			continue;
+
+		if (rec.type == EV_ABS) {
+			for (i = 0; i < sizeof(map) / sizeof(*map); ++i)
+				if (map[i].code == rec.code)
+					cache[map[i].idx].x = rec.value;
+		} else if (rec.type == EV_SYN) {
+			memset(&out[n], 0, sizeof(out[n]));
+			out[n].type = XWII_EVENT_DRUMS_MOVE;
+			set_time(&out[n], hdr.time + rec.time);
+			memcpy(out[n].v.abs, cache, sizeof(cache));
+			++n;
+		}
+	}
+
+	fclose(in);
+	return n;
+}
+
+static uint64_t event_us(const struct xwii_event *ev)
+{
+	return ev->time.tv_sec * 1000000ULL + ev->time.tv_usec;
+}
+
+/*
+ * drums: latency of drum hit events
+ * Replays a recorded drums session, or a synthetic one, through the hit
+ * detection of the library and through the peak detection applications do
+ * on move events, which reports a hit once the pressure drops again. Latency
+ * is measured from the first report that shows a pressure rise.
+ */
+static int bench_drums(int argc, char **argv)
+{
+	static const char *const names[] = { "library", "peak" };
+	struct xwii_event *evs, hits[XWII_DRUMS_ABS_NUM];
+	struct xwii__drums d;
+	uint64_t onset[XWII_DRUMS_ABS_NUM], sum[2] = { 0 }, max[2] = { 0 };
+	uint64_t lat, ns;
+	unsigned int num[2] = { 0 }, i, k, m;
+	int32_t v, last[XWII_DRUMS_ABS_NUM] = { 0 };
+	bool rising[XWII_DRUMS_ABS_NUM] = { false };
+	ssize_t n, j;
+
+	evs = calloc(12000, sizeof(*evs));
+	if (!evs)
+		return -ENOMEM;
+
+	if (argc > 2)
+		n = drums_dump(argv[2], evs, 12000);
+	else
+		n = drums_synthetic(evs, 12000);
+	if (n <= 0) {
+		fprintf(stderr, "No drums reports found\n");
+		free(evs);
+		return n ? n : -ENODATA;
+	}
+
+	/* time the library on its own first */
+	xwii__drums_init(&d);
+	ns = now_ns();
+	for (j = 0; j < n; ++j)
+		xwii__drums_update(&d, &evs[j], hits);
+	ns = now_ns() - ns;
+
+	xwii__drums_init(&d);
+	memset(onset, 0, sizeof(onset));
+	for (j = 0; j < n; ++j) {
+		for (i = XWII_DRUMS_ABS_CYMBAL_LEFT; i < XWII_DRUMS_ABS_NUM;
+		     ++i) {
+			v = evs[j].v.abs[i].x;
+			if (v > last[i] && !rising[i])
+				onset[i] = event_us(&evs[j]);
+
+			/* what applications do without hit events */
+			if (v < last[i] && rising[i]) {
+				lat = event_us(&evs[j]) - onset[i];
+				sum[1] += lat;
+				max[1] = lat > max[1] ? lat : max[1];
+				++num[1];
+			}
+			if (v != last[i])
+				rising[i] = v > last[i];
+			last[i] = v;
+		}
+
+		m = xwii__drums_update(&d, &evs[j], hits);
+		for (k = 0; k < m; ++k) {
+			lat = event_us(&hits[k]) -
+			      onset[hits[k].v.drum_hit.drum];
+			sum[0] += lat;
+			max[0] = lat > max[0] ? lat : max[0];
+			++num[0];
+		}
+	}
+
+	printf("%zd reports of %s, %.1f ns per report\n", n,
+	       argc > 2 ? argv[2] : "synthetic data", (double)ns / n);
+	printf("  %-8s %6s %14s %14s\n", "detector", "hits", "mean (ms)",
+	       "max (ms)");
+	for (m = 0; m < 2; ++m)
+		printf("  %-8s %6u %14.2f %14.2f\n", names[m], num[m],
+		       num[m] ? sum[m] / 1000.0 / num[m] : 0.0,
+		       max[m] / 1000.0);
+
+	free(evs);
+	return 0;
+}
+
+/* serve all devices once; \hub set uses the hub, else drains each device */
+static void schedule_pass(struct xwii_hub *hub, struct xwii_iface **devs,
+			  size_t num, uint64_t *lat, unsigned int *before,
+			  unsigned int *served)
+{
+	struct xwii_event ev;
+	uint64_t start = now_ns();
+	unsigned int slot, n = 0;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < num; ++i)
+		served[i] = 0;
+
+	if (hub) {
+		while ((ret = xwii_hub_dispatch(hub, &slot, &ev,
+						sizeof(ev))) != -EAGAIN) {
+			if (ret || slot >= num)
+				continue;
+			if (!served[slot]++) {
+				lat[slot] = now_ns() - start;
+				before[slot] = n;
+			}
+			++n;
+		}
+		return;
+	}
+
+	for (i = 0; i < num; ++i) {
+		while (xwii_iface_dispatch(devs[i], &ev, sizeof(ev)) !=
+		       -EAGAIN) {
+			if (!served[i]++) {
+				lat[i] = now_ns() - start;
+				before[i] = n;
+			}
+			++n;
+		}
+	}
+}
+
+/* write \num accelerometer reports to the fake node \fd */
+static int schedule_feed(int fd, unsigned int num, uint64_t *us)
+{
+	struct input_event ev[4];
+	unsigned int i, k;
+	ssize_t l;
+
+	memset(ev, 0, sizeof(ev));
+	for (i = 0; i < num; ++i) {
+		*us += 10000;
+		for (k = 0; k < 4; ++k) {
+			ev[k].time.tv_sec = *us / 1000000;
+			ev[k].time.tv_usec = *us % 1000000;
+			ev[k].type = k < 3 ? EV_ABS : EV_SYN;
+			ev[k].code = k < 3 ? ABS_RX + k : SYN_REPORT;
+			ev[k].value = k < 3 ? 500 + i % 7 : 0;
+		}
+
+		l = write(fd, ev, sizeof(ev));
+		if (l != sizeof(ev))
+			return l < 0 ? -errno : -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * schedule: latency of quiet devices while one device floods
+ * Runs on simulated devices whose accelerometer nodes are FIFOs. Each round,
+ * the first device gets a backlog of \backlog reports, like after a Bluetooth
+ * hiccup, and every other device a single report. Then all devices are
+ * served either round-robin by xwii_hub_dispatch() or by draining one device
+ * after the other, starting with the flooding one. Reported is the worst
+ * time and number of events until a quiet device got its report.
+ */
+static int bench_schedule(int argc, char **argv)
+{
+	static const char *const names[] = { "hub", "drain" };
+	char *paths[BENCH_MAX_DEVS], node[PATH_MAX + 32];
+	struct xwii_iface *devs[BENCH_MAX_DEVS] = { NULL };
+	int fds[BENCH_MAX_DEVS];
+	struct xwii_hub *hub = NULL;
+	uint64_t lat[BENCH_MAX_DEVS], worst[2] = { 0 }, us = 0;
+	unsigned int before[BENCH_MAX_DEVS], served[BENCH_MAX_DEVS];
+	unsigned int most[2] = { 0 }, m, backlog, quantum = 4;
+	unsigned long rounds, r;
+	size_t num = 0, real, i;
+	int ret;
+
+	real = arg_num(argc, argv, 2, 8);
+	backlog = arg_num(argc, argv, 3, 1000);
+	rounds = arg_num(argc, argv, 4, 100);
+	if (real < 2 || real > BENCH_MAX_DEVS || !backlog ||
+	    backlog > 10000 || !rounds) {
+		fprintf(stderr, "Invalid device count, backlog or rounds\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < real; ++i)
+		fds[i] = -1;
+
+	ret = fake_tree(real, XWII_IFACE_ACCEL);
+	if (ret) {
+		fprintf(stderr, "Cannot simulate devices: %d\n", ret);
+		return ret;
+	}
+
+	num = collect_devs(paths, real);
+	if (num != real) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	ret = xwii_hub_new(&hub, num);
+	if (!ret)
+		ret = xwii_hub_set_quantum(hub, quantum);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < num; ++i) {
+		ret = xwii_iface_new(&devs[i], paths[i]);
+		if (!ret)
+			ret = xwii_iface_open(devs[i], XWII_IFACE_ACCEL);
+		if (ret)
+			goto out;
+		ret = xwii_hub_add(hub, devs[i]);
+		if (ret < 0)
+			goto out;
+		if ((size_t)ret != i) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		/* accelerometer node, see fake_dev(); the library holds the
+		 * reading end open by now */
+		snprintf(node, sizeof(node), "%s/dev/input/event%lu",
+			 fake_root, strtoul(strrchr(paths[i], '.') + 1, NULL,
+					    16) * 16 + 1);
+		fds[i] = open(node, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fds[i] < 0 || fcntl(fds[i], F_SETPIPE_SZ, 1 << 20) < 0) {
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	for (r = 0; r < rounds * 2; ++r) {
+		m = r % 2;
+		for (i = 0; i < num; ++i) {
+			ret = schedule_feed(fds[i], i ? 1 : backlog, &us);
+			if (ret)
+				goto out;
+		}
+
+		schedule_pass(m ? NULL : hub, devs, num, lat, before, served);
+		for (i = 1; i < num; ++i) {
+			if (!served[i])
+				continue;
+			if (lat[i] > worst[m])
+				worst[m] = lat[i];
+			if (before[i] > most[m])
+				most[m] = before[i];
+		}
+	}
+
+	printf("%zu simulated devices, backlog %u, %lu rounds, quantum %u\n",
+	       num, backlog, rounds, quantum);
+	printf("  %-6s %16s %16s\n", "policy", "worst wait (us)",
+	       "events before");
+	for (m = 0; m < 2; ++m)
+		printf("  %-6s %16.1f %16u\n", names[m], worst[m] / 1000.0,
+		       most[m]);
+
+out:
+	if (ret)
+		fprintf(stderr, "Cannot run simulated devices: %d\n", ret);
+	for (i = 0; i < real; ++i)
+		if (fds[i] >= 0)
+			close(fds[i]);
+	xwii_hub_unref(hub);
+	for (i = 0; i < num; ++i)
+		if (devs[i])
+			xwii_iface_unref(devs[i]);
+	free_devs(paths, num);
+	fake_free();
+	return ret;
+}
+
+struct bench {
+	const char *name;
+	const char *args;
+	const char *help;
+	int (*run) (int argc, char **argv);
+};
+
+static const struct bench benches[] = {
+	{ "new", "[num] [rounds]",
+	  "Construct num device objects eagerly, lazily and concurrently",
+	  bench_new },
+	{ "fusion", "[updates]",
+	  "Orientation fusion updates per second of both kernels",
+	  bench_fusion },
+	{ "smoothing", "[dump]",
+	  "Jitter and lag of IR filters on synthetic data or a recorder dump",
+	  bench_smoothing },
+	{ "hub", "[devices] [passes]",
+	  "Hub filter pass against per-device scalar filtering",
+	  bench_hub },
+	{ "gesture", "[templates] [remotes]",
+	  "Gesture matching load of remotes at 100 Hz",
+	  bench_gesture },
+	{ "drums", "[dump]",
+	  "Drum hit latency on a synthetic session or a recorder dump",
+	  bench_drums },
+	{ "schedule", "[devices] [backlog] [rounds]",
+	  "Worst latency of quiet devices while one device floods",
+	  bench_schedule },
+	{ NULL },
+};
+
+int main(int argc, char **argv)
+{
+	const struct bench *b;
+
+	if (argc < 2 || !strcmp(argv[1], "-h")) {
+		printf("Usage:\n");
+		for (b = benches; b->name; ++b)
+			printf("\txwiibench %s %s: %s\n", b->name, b->args,
+			       b->help);
+		return EXIT_FAILURE;
+	}
+
+	for (b = benches; b->name; ++b) {
+		if (strcmp(argv[1], b->name))
+			continue;
+		if (b->run(argc, argv))
+			return EXIT_FAILURE;
+		return EXIT_SUCCESS;
+	}
+
+	fprintf(stderr, "Unknown benchmark: %s\n", argv[1]);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,528 @@
+/*
+ * XWiimote - tools - xwiicheck
+ * Written 2010-2013 by David Herrmann
+ * Dedicated to the Public Domain
+ */
+
+/*
+ * IR Pointer and Swing Check
+ * Without arguments, a synthetic sensor bar is rendered into IR camera frames
+ * from known poses, with pixel noise, reflections and dropped dots, and
+ * replayed through the pointer solver. The solved cursor, distance and roll
+ * are compared against the poses. Then synthetic accelerometer swings, one of
+ * which ends in another orientation, are replayed through swing detection and
+ * the order and latency of its events are checked. This runs as part of
+ * "make check".
+ *
+ * With a flight recorder dump (see xwii_iface_dump_recorder()) as argument,
+ * its IR and accelerometer events are replayed through the solver instead and
+ * one line "x y distance roll dots" is printed per IR frame. If a file with
+ * such lines is passed as second argument, the results are compared against
+ * it instead, so a reviewed replay can serve as reference for later ones.
+ */
+
+#include <errno.h>
+#include <linux/input.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pointer.h"
+#include "swing.h"
+#include "xwiimote.h"
+
+/*
+ * tolerances; distance is relative. At the far end, pixel noise on both dots
+ * makes the roll jitter by up to 0.04 rad, which moves off-center cursors by
+ * up to 0.025.
+ */
+#define CHECK_POS 0.03f
+#define CHECK_POS_ONE 0.04f
+#define CHECK_DIST 0.05f
+#define CHECK_ROLL 0.05f
+
+/* synthetic frames at 100 Hz */
+#define CHECK_FRAMES 3000
+/* pixel noise amplitude */
+#define CHECK_NOISE 1
+
+/* swing thresholds in g, accelerometer noise amplitude in g/100 */
+#define SWING_START 1.5f
+#define SWING_IMPACT 2.0f
+#define SWING_NOISE 2
+/* samples of the swing scenario and the two swings in it */
+#define SWING_SAMPLES 250
+#define SWING_ONE 50
+#define SWING_TWO 150
+#define SWING_LEN 16
+
+struct pose {
+	float x;
+	float y;
+	float distance;
+	float roll;
+	unsigned int dots;
+};
+
+struct errors {
+	unsigned long frames;
+	unsigned long failed;
+	float pos;
+	float dist;
+	float roll;
+};
+
+/* deterministic pseudo random numbers, so every run checks the same frames */
+static uint32_t check_rand(void)
+{
+	static uint32_t state = 1;
+
+	state = state * 1103515245 + 12345;
+	return state >> 8;
+}
+
+static int check_noise(int amp)
+{
+	return (int)(check_rand() % (2 * amp + 1)) - amp;
+}
+
+static void invalidate(struct xwii_event_abs *abs)
+{
+	abs->x = 1023;
+	abs->y = 1023;
+}
+
+/* store view coordinates \u/\v as camera dot in \abs, if visible */
+static void render_dot(struct xwii_event_abs *abs, float u, float v)
+{
+	int x, y;
+
+	x = lrintf(XWII__IR_WIDTH / 2 - u) + check_noise(CHECK_NOISE);
+	y = lrintf(v + XWII__IR_HEIGHT / 2) + check_noise(CHECK_NOISE);
+	if (x < 0 || x >= XWII__IR_WIDTH || y < 0 || y >= XWII__IR_HEIGHT)
+		return;
+
+	abs->x = x;
+	abs->y = y;
+}
+
+/*
+ * Render the sensor bar of pose \p into \ev. This inverts the projection of
+ * the solver: the bar center is rotated by the roll, both dots sit half the
+ * bar width apart along the rolled horizon.
+ */
+static void render(const struct pose *p, struct xwii_event *ev,
+		   unsigned int left, unsigned int right, bool drop)
+{
+	float c = cosf(p->roll), s = sinf(p->roll), sx, sy, mx, my, sep;
+	unsigned int i;
+
+	for (i = 0; i < 4; ++i)
+		invalidate(&ev->v.abs[i]);
+
+	sx = p->x * (XWII__IR_WIDTH / 2);
+	sy = p->y * (XWII__IR_HEIGHT / 2);
+	mx = sx * c - sy * s;
+	my = sx * s + sy * c;
+	sep = XWII__IR_BAR_WIDTH * XWII__IR_FOCAL / p->distance / 2;
+
+	render_dot(&ev->v.abs[left], mx - sep * c, my - sep * s);
+	if (!drop)
+		render_dot(&ev->v.abs[right], mx + sep * c, my + sep * s);
+}
+
+/* put a reflection into \slot, away from the dots in \left and \right */
+static void reflect(struct xwii_event *ev, unsigned int slot,
+		    unsigned int left, unsigned int right)
+{
+	const struct xwii_event_abs *l = &ev->v.abs[left];
+	const struct xwii_event_abs *r = &ev->v.abs[right];
+	struct xwii_event_abs *d = &ev->v.abs[slot];
+	int min = 2 * XWII__IR_TRACK_DIST;
+
+	do {
+		d->x = check_rand() % XWII__IR_WIDTH;
+		d->y = check_rand() % XWII__IR_HEIGHT;
+	} while ((abs(d->x - l->x) < min && abs(d->y - l->y) < min) ||
+		 (abs(d->x - r->x) < min && abs(d->y - r->y) < min));
+}
+
+static float angle_diff(float a, float b)
+{
+	float d = fmodf(a - b, 2 * (float)M_PI);
+
+	if (d > (float)M_PI)
+		d -= 2 * (float)M_PI;
+	else if (d < -(float)M_PI)
+		d += 2 * (float)M_PI;
+	return fabsf(d);
+}
+
+/* compare solver output \o against \p; returns true if within tolerance */
+static bool compare(const struct xwii_event_pointer *o, const struct pose *p,
+		    struct errors *e)
+{
+	float pos, dist, roll, tol;
+
+	pos = fmaxf(fabsf(o->x - p->x), fabsf(o->y - p->y));
+	dist = p->distance ? fabsf(o->distance - p->distance) / p->distance : 0;
+	roll = angle_diff(o->roll, p->roll);
+	tol = p->dots == 2 ? CHECK_POS : CHECK_POS_ONE;
+
+	++e->frames;
+	e->pos = fmaxf(e->pos, pos);
+	e->dist = fmaxf(e->dist, dist);
+	e->roll = fmaxf(e->roll, roll);
+
+	if (o->dots != p->dots || pos > tol || roll > CHECK_ROLL ||
+	    (p->dots == 2 && dist > CHECK_DIST)) {
+		++e->failed;
+		return false;
+	}
+
+	return true;
+}
+
+static void pose_at(struct pose *p, unsigned int i)
+{
+	float t = i * 0.01f;
+
+	p->x = 0.5f * sinf(t * 0.7f);
+	p->y = 0.4f * sinf(t * 1.1f);
+	p->roll = 0.5f * sinf(t * 0.3f);
+	p->distance = 2.5f + 1.2f * sinf(t * 0.2f);
+}
+
+/* replay synthetic frames; returns the number of failed frames */
+static unsigned long check_synthetic(void)
+{
+	struct xwii__pointer ptr;
+	struct xwii_event ev, out;
+	struct xwii_event_abs accel;
+	struct errors e;
+	struct pose p;
+	unsigned int i, left, right, refl;
+	bool drop;
+
+	memset(&ev, 0, sizeof(ev));
+	memset(&e, 0, sizeof(e));
+	ev.type = XWII_EVENT_IR;
+	xwii__pointer_init(&ptr);
+
+	for (i = 0; i < CHECK_FRAMES; ++i) {
+		pose_at(&p, i);
+
+		/* the camera assigns slots freely, so shuffle them */
+		left = (i / 50) % 4;
+		right = (left + 1 + (i / 200) % 3) % 4;
+		refl = (right + 1) % 4;
+		if (refl == left)
+			refl = (refl + 1) % 4;
+
+		/* drop one dot for single frames after tracking settled */
+		drop = i > 10 && i % 23 == 0;
+		p.dots = drop ? 1 : 2;
+		render(&p, &ev, left, right, drop);
+
+		/* reflections show up in a free slot, away from the bar */
+		if (i > 10 && i % 7 == 0)
+			reflect(&ev, refl, left, right);
+
+		accel.x = lrintf(100 * sinf(p.roll)) + check_noise(3);
+		accel.y = 0;
+		accel.z = lrintf(100 * cosf(p.roll)) + check_noise(3);
+
+		ev.time.tv_sec = i / 100;
+		ev.time.tv_usec = (i % 100) * 10000;
+		xwii__pointer_update(&ptr, &ev, &accel, &out);
+
+		if (!compare(&out.v.pointer, &p, &e))
+			fprintf(stderr, "frame %u: got %.3f %.3f %.2f %.3f %u, "
+				"expected %.3f %.3f %.2f %.3f %u\n", i,
+				out.v.pointer.x, out.v.pointer.y,
+				out.v.pointer.distance, out.v.pointer.roll,
+				out.v.pointer.dots, p.x, p.y, p.distance,
+				p.roll, p.dots);
+	}
+
+	printf("synthetic: %lu frames, %lu failed, max error: position %.4f, "
+	       "distance %.1f%%, roll %.4f\n", e.frames, e.failed, e.pos,
+	       e.dist * 100, e.roll);
+	return e.failed;
+}
+
+/* replay the IR frames of dump \file; compare against \ref if non-NULL */
+static int check_replay(const char *file, const char *ref)
+{
+	struct xwii_recorder_header hdr;
+	struct xwii_recorder_record rec;
+	struct xwii__pointer ptr;
+	struct xwii_event ev, out;
+	struct xwii_event_abs accel;
+	const struct xwii_event_pointer *o = &out.v.pointer;
+	struct errors e;
+	struct pose p;
+	FILE *in, *refs = NULL;
+	uint64_t t;
+	uint32_t n;
+	unsigned int ir = __builtin_ctz(XWII_IFACE_IR);
+	unsigned int acc = __builtin_ctz(XWII_IFACE_ACCEL), i;
+	bool has_accel = false;
+	int ret = 0;
+
+	in = fopen(file, "rb");
+	if (!in) {
+		fprintf(stderr, "Cannot open %s: %d\n", file, errno);
+		return -errno;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+	    memcmp(hdr.magic, XWII_RECORDER_MAGIC, sizeof(hdr.magic))) {
+		fprintf(stderr, "Invalid flight recorder dump %s\n", file);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (ref) {
+		refs = fopen(ref, "r");
+		if (!refs) {
+			fprintf(stderr, "Cannot open %s: %d\n", ref, errno);
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	memset(&accel, 0, sizeof(accel));
+	memset(&e, 0, sizeof(e));
+	ev.type = XWII_EVENT_IR;
+	for (i = 0; i < 4; ++i)
+		invalidate(&ev.v.abs[i]);
+	xwii__pointer_init(&ptr);
+
+	for (n = 0; n < hdr.num; ++n) {
+		if (fread(&rec, sizeof(rec), 1, in) != 1) {
+			fprintf(stderr, "Truncated flight recorder dump\n");
+			ret = -EINVAL;
+			goto out;
+		}
+
+		if (rec.iface == acc && rec.type == EV_ABS) {
+			has_accel = true;
+			if (rec.code == ABS_RX)
+				accel.x = rec.value;
+			else if (rec.code == ABS_RY)
+				accel.y = rec.value;
+			else if (rec.code == ABS_RZ)
+				accel.z = rec.value;
+		}
+
+		if (rec.iface != ir)
+			continue;
+
+		if (rec.type == EV_ABS && rec.code >= ABS_HAT0X &&
+		    rec.code <= ABS_HAT3Y) {
+			i = rec.code - ABS_HAT0X;
+			if (i % 2)
+				ev.v.abs[i / 2].y = rec.value;
+			else
+				ev.v.abs[i / 2].x = rec.value;
+			continue;
+		} else if (rec.type != EV_SYN) {
+			continue;
+		}
+
+		t = hdr.time + rec.time;
+		ev.time.tv_sec = t / 1000000;
+		ev.time.tv_usec = t % 1000000;
+		xwii__pointer_update(&ptr, &ev, has_accel ? &accel : NULL,
+				     &out);
+
+		if (!refs) {
+			printf("%.4f %.4f %.3f %.4f %u\n", o->x, o->y,
+			       o->distance, o->roll, o->dots);
+			continue;
+		}
+
+		if (fscanf(refs, "%f %f %f %f %u", &p.x, &p.y, &p.distance,
+			   &p.roll, &p.dots) != 5) {
+			fprintf(stderr, "Reference ends early\n");
+			ret = -EINVAL;
+			goto out;
+		}
+
+		if (!compare(o, &p, &e))
+			fprintf(stderr, "frame %lu differs from reference\n",
+				e.frames - 1);
+	}
+
+	if (refs) {
+		printf("replay: %lu frames, %lu failed, max error: position "
+		       "%.4f, distance %.1f%%, roll %.4f\n", e.frames,
+		       e.failed, e.pos, e.dist * 100, e.roll);
+		if (e.failed)
+			ret = -EINVAL;
+	}
+
+out:
+	if (refs)
+		fclose(refs);
+	fclose(in);
+	return ret;
+}
+
+/*
+ * Noise-free sample \i of the swing scenario in g: the remote rests, swings
+ * along x and stops with a jolt, rests, swings along y and rests again. With
+ * \turn, it is rotated by 90 degrees during the first swing.
+ */
+static void swing_at(float v[3], unsigned int i, bool turn)
+{
+	float a[3] = { 0.0f, 0.0f, 0.0f }, phi = 0.0f;
+
+	if (i >= SWING_ONE && i < SWING_ONE + SWING_LEN)
+		a[0] = 3.0f * sinf(M_PI * (i - SWING_ONE) / SWING_LEN);
+	else if (i == SWING_ONE + SWING_LEN)
+		a[0] = -2.5f;
+	else if (i >= SWING_TWO && i < SWING_TWO + SWING_LEN)
+		a[1] = 3.0f * sinf(M_PI * (i - SWING_TWO) / SWING_LEN);
+
+	if (turn && i >= SWING_ONE + SWING_LEN)
+		phi = M_PI / 2;
+	else if (turn && i >= SWING_ONE)
+		phi = M_PI / 2 * (i - SWING_ONE) / SWING_LEN;
+
+	v[0] = sinf(phi) + a[0];
+	v[1] = a[1];
+	v[2] = cosf(phi) + a[2];
+}
+
+/*
+ * sample at which the first peak of swing one should be reported: the first
+ * one after the maximum that dropped below 80% of it, relative to gravity at
+ * the start of the swing
+ */
+static unsigned int swing_expected_peak(bool turn, unsigned int *top)
+{
+	float v[3], m, max = 0.0f;
+	unsigned int i;
+
+	*top = SWING_ONE;
+	for (i = SWING_ONE; i < SWING_TWO; ++i) {
+		swing_at(v, i, turn);
+		m = sqrtf(v[0] * v[0] + v[1] * v[1] + (v[2] - 1) * (v[2] - 1));
+		if (m > max) {
+			max = m;
+			*top = i;
+		} else if (m < max * XWII__SWING_DROP) {
+			return i;
+		}
+	}
+
+	return i;
+}
+
+/* replay one swing scenario; returns the number of failed checks */
+static unsigned long check_swing_run(bool turn)
+{
+	struct xwii__swing s;
+	struct xwii_event ev, out[2];
+	unsigned int i, k, n, at, peak, top, starts = 0, impacts = 0;
+	int first_peak = -1, impact = -1, second = -1;
+	unsigned long failed = 0;
+	float v[3];
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = XWII_EVENT_ACCEL;
+	xwii__swing_init(&s, SWING_START, SWING_IMPACT, true);
+	peak = swing_expected_peak(turn, &top);
+
+	for (i = 0; i < SWING_SAMPLES; ++i) {
+		swing_at(v, i, turn);
+		for (k = 0; k < 3; ++k)
+			v[k] += check_noise(SWING_NOISE) / 100.0f;
+
+		ev.time.tv_sec = i / 100;
+		ev.time.tv_usec = (i % 100) * 10000;
+		n = xwii__swing_update(&s, &ev, v, XWII_IFACE_ACCEL, out);
+
+		for (k = 0; k < n; ++k) {
+			switch (out[k].v.swing.phase) {
+			case XWII_SWING_START:
+				if (starts++ && second < 0)
+					second = i;
+				break;
+			case XWII_SWING_PEAK:
+				if (first_peak >= 0)
+					break;
+				first_peak = i;
+				/* the peak carries the time of the maximum */
+				at = out[k].time.tv_sec * 100 +
+				     out[k].time.tv_usec / 10000;
+				if (at + 1 < top || at > top + 1) {
+					fprintf(stderr, "swing: peak at %u, "
+						"maximum at %u\n", at, top);
+					++failed;
+				}
+				break;
+			case XWII_SWING_IMPACT:
+				++impacts;
+				impact = i;
+				break;
+			}
+		}
+	}
+
+	printf("swing%s: %u starts, peak reported %d samples after the "
+	       "maximum, impact at %d\n", turn ? " with turn" : "", starts,
+	       first_peak - (int)top, impact);
+
+	/* START -> PEAK -> IMPACT within swing one */
+	if (starts != 2 || first_peak < SWING_ONE ||
+	    first_peak > impact || impacts != 1 ||
+	    impact != SWING_ONE + SWING_LEN) {
+		fprintf(stderr, "swing: wrong events of the first swing\n");
+		++failed;
+	}
+	if (first_peak > (int)peak + 1) {
+		fprintf(stderr, "swing: peak reported at %d, expected %u\n",
+			first_peak, peak);
+		++failed;
+	}
+	/* detection re-armed for the second swing */
+	if (second < SWING_TWO || second >= SWING_TWO + SWING_LEN) {
+		fprintf(stderr, "swing: second swing started at %d\n", second);
+		++failed;
+	}
+
+	return failed;
+}
+
+static unsigned long check_swing(void)
+{
+	return check_swing_run(false) + check_swing_run(true);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long failed;
+
+	if (argc > 1 && !strcmp(argv[1], "-h")) {
+		printf("Usage:\n");
+		printf("\txwiicheck: Check pointer accuracy and swing "
+		       "detection on synthetic data\n");
+		printf("\txwiicheck <dump> [reference]: Replay IR frames of a "
+		       "flight recorder dump\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 1)
+		return check_replay(argv[1], argc > 2 ? argv[2] : NULL) ?
+						EXIT_FAILURE : EXIT_SUCCESS;
+
+	failed = check_synthetic();
+	failed += check_swing();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -2397,14 +2397,19 @@ static void handle_resize(void)
 static void handle_watch(void)
 {
 	static unsigned int num;
+	unsigned int missing;
 	int ret;
 
+	/* new interfaces are opened by the library, see run_iface() */
 	print_info("Info: Watch Event #%u", ++num);
 
-	ret = xwii_iface_open(iface, xwii_iface_available(iface) |
-				     XWII_IFACE_WRITABLE);
-	if (ret)
-		print_error("Error: Cannot open interface: %d", ret);
+	/* retry what the library failed to reopen to get the error code */
+	missing = xwii_iface_available(iface) & ~xwii_iface_opened(iface);
+	if (missing) {
+		ret = xwii_iface_open(iface, missing | XWII_IFACE_WRITABLE);
+		if (ret)
+			print_error("Error: Cannot open interface: %d", ret);
+	}
 
 	refresh_all();
 }
@@ -2506,6 +2511,7 @@ static int run_iface(struct xwii_iface *iface)
 	ret = xwii_iface_watch(iface, true);
 	if (ret)
 		print_error("Error: Cannot initialize hotplug watch descriptor");
+	xwii_iface_set_auto_open(iface, XWII_IFACE_ALL | XWII_IFACE_WRITABLE);
 
 	while (true) {
 		ret = poll(fds, fds_num, -1);